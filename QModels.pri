@@ -9,27 +9,55 @@ HEADERS += \
     $$PWD/qconcatenateproxymodel.h \
     $$PWD/qemptymodel.h \
     $$PWD/qmodelhelper.h \
+    $$PWD/qmappedfile.h \
     $$PWD/qobjectlistmodel.h \
     $$PWD/qobjectlistmodelbase.h \
     $$PWD/qobjectlistproperty.h \
     $$PWD/qvariantlistmodel.h \
+    $$PWD/qvariantlistbinary.h \
+    $$PWD/qvariantlistfilemodel.h \
+    $$PWD/qvariantlistfieldindex.h \
+    $$PWD/qvariantlistloader.h \
+    $$PWD/qvariantlistrows.h \
+    $$PWD/qvariantlistsnapshot.h \
+    $$PWD/qvariantlistsorter.h \
     $$PWD/qmodelmatcher.h \
     $$PWD/qjsontreemodel.h \
     $$PWD/qjsonlistmodel.h \
+    $$PWD/qcborarrayreader.h \
+    $$PWD/qjsonarrayreader.h \
+    $$PWD/qjsonlinesreader.h \
+    $$PWD/qjsonlistwriter.h \
+    $$PWD/qjsonrowdecoder.h \
     $$PWD/qcheckableproxymodel.h \
     $$PWD/qcsvlistmodel.h \
+    $$PWD/qcsvreader.h \
     $$PWD/qmodels_log.h
 
 SOURCES += \
     $$PWD/qmodels_qmltypes.cpp \
     $$PWD/qconcatenateproxymodel.cpp \
     $$PWD/qmodelhelper.cpp \
+    $$PWD/qmappedfile.cpp \
     $$PWD/qvariantlistmodel.cpp \
+    $$PWD/qvariantlistbinary.cpp \
+    $$PWD/qvariantlistfilemodel.cpp \
+    $$PWD/qvariantlistfieldindex.cpp \
+    $$PWD/qvariantlistloader.cpp \
+    $$PWD/qvariantlistrows.cpp \
+    $$PWD/qvariantlistsnapshot.cpp \
+    $$PWD/qvariantlistsorter.cpp \
     $$PWD/qmodelmatcher.cpp \
     $$PWD/qjsontreemodel.cpp \
     $$PWD/qjsonlistmodel.cpp \
+    $$PWD/qcborarrayreader.cpp \
+    $$PWD/qjsonarrayreader.cpp \
+    $$PWD/qjsonlinesreader.cpp \
+    $$PWD/qjsonlistwriter.cpp \
+    $$PWD/qjsonrowdecoder.cpp \
     $$PWD/qcheckableproxymodel.cpp \
-    $$PWD/qcsvlistmodel.cpp
+    $$PWD/qcsvlistmodel.cpp \
+    $$PWD/qcsvreader.cpp
 
 DISTFILES += \
     $$PWD/QModels \
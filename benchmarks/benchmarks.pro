@@ -0,0 +1,7 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    binary \
+    cbor \
+    csv \
+    variantlistmodel
@@ -0,0 +1,112 @@
+#include <QtTest>
+
+#include "qjsonlistmodel.h"
+
+// Loading and saving the same rows through the binary format of QVariantListModel and through JSON
+class BenchBinary: public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr int RowCount = 100000;
+
+    QTemporaryDir m_dir;
+    QString m_binaryPath;
+    QString m_jsonPath;
+    QByteArray m_json;
+
+private slots:
+    void initTestCase();
+
+    void loadBinary();
+    void loadJson();
+    void loadPath();
+    void saveBinary();
+    void syncPath();
+};
+
+void BenchBinary::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_binaryPath = m_dir.filePath(QStringLiteral("rows.bin"));
+    m_jsonPath = m_dir.filePath(QStringLiteral("rows.json"));
+
+    QVariantList storage;
+    storage.reserve(RowCount);
+    for(int row = 0; row < RowCount; ++row)
+    {
+        storage.append(QVariantMap{
+            {QStringLiteral("id"), row},
+            {QStringLiteral("name"), QStringLiteral("item %1").arg(row)},
+            {QStringLiteral("category"), QStringLiteral("category %1").arg(row % 16)},
+            {QStringLiteral("price"), row * 0.25},
+            {QStringLiteral("available"), row % 3 != 0}
+        });
+    }
+
+    QJsonListModel model;
+    model.setStorage(storage);
+    QVERIFY(model.saveBinary(m_binaryPath));
+    QVERIFY(model.syncPath(m_jsonPath, QJsonListModel::Compact));
+    m_json = model.toJson(QJsonListModel::Compact);
+
+    qInfo() << "binary:" << QFileInfo(m_binaryPath).size() << "bytes, json:" << QFileInfo(m_jsonPath).size() << "bytes";
+}
+
+void BenchBinary::loadBinary()
+{
+    QVariantListModel model;
+    QBENCHMARK
+    {
+        QVERIFY(model.loadBinary(m_binaryPath));
+    }
+    QCOMPARE(model.count(), RowCount);
+}
+
+void BenchBinary::loadJson()
+{
+    QJsonListModel model;
+    QBENCHMARK
+    {
+        QVERIFY(model.loadJson(m_json));
+    }
+    QCOMPARE(model.count(), RowCount);
+}
+
+void BenchBinary::loadPath()
+{
+    QJsonListModel model;
+    QBENCHMARK
+    {
+        QVERIFY(model.loadPath(m_jsonPath));
+    }
+    QCOMPARE(model.count(), RowCount);
+}
+
+void BenchBinary::saveBinary()
+{
+    QVariantListModel model;
+    QVERIFY(model.loadBinary(m_binaryPath));
+
+    const QString path = m_dir.filePath(QStringLiteral("saved.bin"));
+    QBENCHMARK
+    {
+        QVERIFY(model.saveBinary(path));
+    }
+}
+
+void BenchBinary::syncPath()
+{
+    QJsonListModel model;
+    QVERIFY(model.loadPath(m_jsonPath));
+
+    const QString path = m_dir.filePath(QStringLiteral("saved.json"));
+    QBENCHMARK
+    {
+        QVERIFY(model.syncPath(path, QJsonListModel::Compact));
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchBinary)
+
+#include "tst_bench_binary.moc"
@@ -0,0 +1,93 @@
+#include <QtTest>
+
+#include "qjsonlistmodel.h"
+
+// Size and speed of the CBOR path of QJsonListModel against compact JSON, on the same rows
+class BenchCbor: public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr int RowCount = 100000;
+
+    QJsonListModel m_model;
+    QByteArray m_cbor;
+    QByteArray m_json;
+
+private slots:
+    void initTestCase();
+
+    void toCbor();
+    void toJson();
+    void loadCbor();
+    void loadJson();
+};
+
+void BenchCbor::initTestCase()
+{
+    QVariantList storage;
+    storage.reserve(RowCount);
+    for(int row = 0; row < RowCount; ++row)
+    {
+        storage.append(QVariantMap{
+            {QStringLiteral("id"), row},
+            {QStringLiteral("name"), QStringLiteral("item %1").arg(row)},
+            {QStringLiteral("price"), row * 0.25},
+            {QStringLiteral("available"), row % 3 != 0},
+            {QStringLiteral("tags"), QVariantList{QStringLiteral("a"), row % 7}}
+        });
+    }
+    m_model.setStorage(storage);
+
+    m_cbor = m_model.toCbor();
+    m_json = m_model.toJson(QJsonListModel::Compact);
+    QVERIFY(!m_cbor.isEmpty());
+    QVERIFY(!m_json.isEmpty());
+
+    qInfo() << "cbor:" << m_cbor.size() << "bytes, json:" << m_json.size() << "bytes,"
+            << qRound(100.0 * m_cbor.size() / m_json.size()) << "%";
+}
+
+void BenchCbor::toCbor()
+{
+    QByteArray cbor;
+    QBENCHMARK
+    {
+        cbor = m_model.toCbor();
+    }
+    QCOMPARE(cbor.size(), m_cbor.size());
+}
+
+void BenchCbor::toJson()
+{
+    QByteArray json;
+    QBENCHMARK
+    {
+        json = m_model.toJson(QJsonListModel::Compact);
+    }
+    QCOMPARE(json.size(), m_json.size());
+}
+
+void BenchCbor::loadCbor()
+{
+    QJsonListModel model;
+    QBENCHMARK
+    {
+        QVERIFY(model.loadCbor(m_cbor));
+    }
+    QCOMPARE(model.count(), RowCount);
+}
+
+void BenchCbor::loadJson()
+{
+    QJsonListModel model;
+    QBENCHMARK
+    {
+        QVERIFY(model.loadJson(m_json));
+    }
+    QCOMPARE(model.count(), RowCount);
+}
+
+QTEST_GUILESS_MAIN(BenchCbor)
+
+#include "tst_bench_cbor.moc"
@@ -0,0 +1,148 @@
+#include <QtTest>
+
+#include <functional>
+
+#include "qcsvlistmodel.h"
+#include "qcsvreader.h"
+
+// Throughput of QCsvReader in bytes per second, against the QTextStream::readLine() and QString::split()
+// loop QCsvListModel used before and against a plain byte loop splitting the same text
+class BenchCsv: public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr int RowCount = 200000;
+    static constexpr char Separator = ';';
+
+    // Calls parse until a second went by and reports the bytes parsed per second.
+    // parse returns the number of fields it read
+    void measure(const std::function<int()>& parse);
+
+    QByteArray m_csv;
+    int m_fieldCount=0;
+
+private slots:
+    void initTestCase();
+
+    void csvReader();
+    void csvReaderDevice();
+    void byteLoop();
+    void textStreamSplit();
+    void loadCsv();
+};
+
+void BenchCsv::measure(const std::function<int()>& parse)
+{
+    QElapsedTimer timer;
+    qint64 iterations = 0;
+    timer.start();
+    do
+    {
+        QCOMPARE(parse(), m_fieldCount);
+        ++iterations;
+    }
+    while(timer.elapsed() < 1000);
+
+    QTest::setBenchmarkResult(qreal(m_csv.size()) * iterations * 1000 / timer.elapsed(), QTest::BytesPerSecond);
+}
+
+void BenchCsv::initTestCase()
+{
+    // Unquoted fields only, so that every parser reads the same fields
+    m_csv = "id;name;category;price;date\n";
+    for(int row = 0; row < RowCount; ++row)
+    {
+        m_csv += QByteArray::number(row) + Separator
+               + "item " + QByteArray::number(row) + Separator
+               + "category " + QByteArray::number(row % 16) + Separator
+               + QByteArray::number(row * 0.25) + Separator
+               + "2020-01-" + QByteArray::number(1 + row % 28).rightJustified(2, '0') + '\n';
+    }
+    m_fieldCount = (RowCount + 1) * 5;
+
+    qInfo() << "csv:" << m_csv.size() << "bytes";
+}
+
+void BenchCsv::csvReader()
+{
+    measure([this]() {
+        QCsvReader reader(m_csv.constData(), m_csv.size(), Separator);
+        QVector<QString> record;
+        int fields = 0;
+        while(reader.readRecord(record))
+            fields += record.count();
+        return fields;
+    });
+}
+
+void BenchCsv::csvReaderDevice()
+{
+    measure([this]() {
+        QBuffer buffer(&m_csv);
+        buffer.open(QIODevice::ReadOnly);
+        QCsvReader reader(&buffer, Separator);
+        QVector<QString> record;
+        int fields = 0;
+        while(reader.readRecord(record))
+            fields += record.count();
+        return fields;
+    });
+}
+
+void BenchCsv::byteLoop()
+{
+    // One byte at a time, without quote handling
+    measure([this]() {
+        const char* it = m_csv.constData();
+        const char* end = it + m_csv.size();
+        QVector<QString> record;
+        int fields = 0;
+        while(it < end)
+        {
+            record.resize(0);
+            const char* begin = it;
+            for(; it < end; ++it)
+            {
+                if(*it != Separator && *it != '\n')
+                    continue;
+
+                record.append(QString::fromUtf8(begin, int(it - begin)));
+                begin = it + 1;
+                if(*it == '\n')
+                    break;
+            }
+            ++it;
+            fields += record.count();
+        }
+        return fields;
+    });
+}
+
+void BenchCsv::textStreamSplit()
+{
+    measure([this]() {
+        QTextStream stream(m_csv);
+        stream.setCodec("UTF-8");
+        int fields = 0;
+        QString line;
+        while(stream.readLineInto(&line))
+            fields += line.split(QLatin1Char(Separator)).count();
+        return fields;
+    });
+}
+
+void BenchCsv::loadCsv()
+{
+    // The whole load, records converted to rows and stored in the model
+    QCsvListModel model;
+    model.setHasHeader(true);
+    measure([this, &model]() {
+        model.loadCsv(m_csv);
+        return (model.count() + 1) * model.fields().count();
+    });
+}
+
+QTEST_GUILESS_MAIN(BenchCsv)
+
+#include "tst_bench_csv.moc"
@@ -0,0 +1,103 @@
+#include <QtTest>
+
+#include "qvariantlistmodel.h"
+
+// Per cell read cost of a model against the number of fields of its items.
+// Reading a cell through data() or through a mapView() of an item shouldn't depend on it,
+// unlike the toMap() copy it replaced.
+class BenchVariantListModel: public QObject
+{
+    Q_OBJECT
+
+private:
+    static QVariantList items(int fieldCount);
+    static void addFieldCounts();
+
+    static const int RowCount = 10000;
+
+private slots:
+    void data_data() { addFieldCounts(); }
+    void data();
+    void mapView_data() { addFieldCounts(); }
+    void mapView();
+    void toMap_data() { addFieldCounts(); }
+    void toMap();
+};
+
+QVariantList BenchVariantListModel::items(int fieldCount)
+{
+    QVariantList ret;
+    ret.reserve(RowCount);
+    for(int row = 0; row < RowCount; ++row)
+    {
+        QVariantMap item;
+        for(int field = 0; field < fieldCount; ++field)
+            item.insert(QStringLiteral("field%1").arg(field, 3, 10, QChar('0')), row * fieldCount + field);
+        ret.append(item);
+    }
+    return ret;
+}
+
+void BenchVariantListModel::addFieldCounts()
+{
+    QTest::addColumn<int>("fieldCount");
+    for(const int fieldCount: {1, 8, 32, 128})
+        QTest::addRow("%d fields", fieldCount) << fieldCount;
+}
+
+void BenchVariantListModel::data()
+{
+    QFETCH(int, fieldCount);
+
+    QVariantListModel model;
+    model.setStorage(items(fieldCount));
+    const int role = Qt::UserRole + fieldCount;
+
+    qint64 sum = 0;
+    QBENCHMARK
+    {
+        for(int row = 0; row < RowCount; ++row)
+            sum += model.data(model.index(row), role).toLongLong();
+    }
+    QVERIFY(sum != 0);
+}
+
+void BenchVariantListModel::mapView()
+{
+    QFETCH(int, fieldCount);
+
+    const QVariantList storage = items(fieldCount);
+    const QString key = QStringLiteral("field%1").arg(fieldCount - 1, 3, 10, QChar('0'));
+
+    qint64 sum = 0;
+    QBENCHMARK
+    {
+        for(const QVariant& item: storage)
+            sum += QVariantListModel::mapView(item)->value(key).toLongLong();
+    }
+    QVERIFY(sum != 0);
+}
+
+void BenchVariantListModel::toMap()
+{
+    QFETCH(int, fieldCount);
+
+    const QVariantList storage = items(fieldCount);
+    const QString key = QStringLiteral("field%1").arg(fieldCount - 1, 3, 10, QChar('0'));
+
+    // The copy the read path made before mapView()
+    qint64 sum = 0;
+    QBENCHMARK
+    {
+        for(const QVariant& item: storage)
+        {
+            QVariantMap map = item.toMap();
+            sum += map[key].toLongLong();
+        }
+    }
+    QVERIFY(sum != 0);
+}
+
+QTEST_GUILESS_MAIN(BenchVariantListModel)
+
+#include "tst_bench_variantlistmodel.moc"
@@ -0,0 +1,11 @@
+QT += qml testlib
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = bench_variantlistmodel
+
+include(../../QModels.pri)
+
+SOURCES += \
+    tst_bench_variantlistmodel.cpp
@@ -0,0 +1,270 @@
+#include "qcborarrayreader.h"
+
+#include <QCborValue>
+#include <QFloat16>
+
+QCborArrayReader::QCborArrayReader(QIODevice* device) :
+    m_reader(device)
+{
+
+}
+
+void QCborArrayReader::setProjection(const QStringList& fields)
+{
+    m_fields.clear();
+    m_fieldIndexes.clear();
+    m_projected = false;
+    for(const QString& field: fields)
+        fieldColumn(field);
+    m_projected = !fields.isEmpty();
+}
+
+bool QCborArrayReader::readNext(QVariant& item)
+{
+    if(!nextElement())
+        return false;
+
+    return readValue(item, 0);
+}
+
+bool QCborArrayReader::readNextRow(Row& row, QVariant& item, bool& isObject)
+{
+    if(!nextElement())
+        return false;
+
+    isObject = m_reader.isMap();
+    if(!isObject)
+    {
+        row.clear();
+        return readValue(item, 0);
+    }
+
+    row.clear();
+    row.resize(m_fields.count());
+    if(!m_reader.enterContainer())
+        return checkError();
+
+    while(m_reader.hasNext())
+    {
+        QString key;
+        if(!m_reader.isString())
+            return setError(QStringLiteral("map key is not a string"));
+        if(!readString(key))
+            return false;
+
+        const int column = fieldColumn(key);
+        if(column < 0)
+        {
+            m_reader.next();
+            continue;
+        }
+
+        if(row.count() < m_fields.count())
+            row.resize(m_fields.count());
+        if(!readValue(row[column], 1))
+            return false;
+    }
+
+    m_reader.leaveContainer();
+    return checkError();
+}
+
+bool QCborArrayReader::nextElement()
+{
+    if(m_state == AfterArray || hasError())
+        return false;
+
+    if(m_state == BeforeArray)
+    {
+        if(!m_reader.isArray())
+            return checkError() && setError(QStringLiteral("cannot load non array cbor"));
+        m_reader.enterContainer();
+        m_state = InArray;
+    }
+
+    if(!checkError())
+        return false;
+
+    if(!m_reader.hasNext())
+    {
+        m_reader.leaveContainer();
+        m_state = AfterArray;
+        checkError();
+        return false;
+    }
+
+    return true;
+}
+
+bool QCborArrayReader::readValue(QVariant& value, int depth)
+{
+    if(depth > MaxDepth)
+        return setError(QStringLiteral("cbor is too deeply nested"));
+
+    switch(m_reader.type())
+    {
+    case QCborStreamReader::UnsignedInteger:
+    case QCborStreamReader::NegativeInteger:
+        value = m_reader.toInteger();
+        m_reader.next();
+        break;
+    case QCborStreamReader::Float16:
+        value = double(float(m_reader.toFloat16()));
+        m_reader.next();
+        break;
+    case QCborStreamReader::Float:
+        value = double(m_reader.toFloat());
+        m_reader.next();
+        break;
+    case QCborStreamReader::Double:
+        value = m_reader.toDouble();
+        m_reader.next();
+        break;
+    case QCborStreamReader::SimpleType:
+        if(m_reader.isBool())
+            value = m_reader.toBool();
+        else if(m_reader.isNull())
+            value = QVariant::fromValue(nullptr);
+        else
+            value = QVariant();
+        m_reader.next();
+        break;
+    case QCborStreamReader::String:
+    {
+        QString string;
+        if(!readString(string))
+            return false;
+        value = string;
+        break;
+    }
+    case QCborStreamReader::ByteArray:
+    {
+        QByteArray bytes;
+        if(!readByteArray(bytes))
+            return false;
+        value = bytes;
+        break;
+    }
+    case QCborStreamReader::Map:
+    {
+        QVariantMap map;
+        if(!readMap(map, depth + 1))
+            return false;
+        value = map;
+        break;
+    }
+    case QCborStreamReader::Array:
+    {
+        QVariantList list;
+        if(!readArray(list, depth + 1))
+            return false;
+        value = list;
+        break;
+    }
+    default:
+        // Tagged values like dates and urls are rare, QCborValue knows how to convert them
+        value = QCborValue::fromCbor(m_reader).toVariant();
+        break;
+    }
+
+    return checkError();
+}
+
+bool QCborArrayReader::readMap(QVariantMap& map, int depth)
+{
+    if(!m_reader.enterContainer())
+        return checkError();
+
+    while(m_reader.hasNext())
+    {
+        QString key;
+        if(!m_reader.isString())
+            return setError(QStringLiteral("map key is not a string"));
+        if(!readString(key))
+            return false;
+
+        // The projection only applies to the members of the top level map
+        if(m_projected && depth == 1 && !m_fieldIndexes.contains(key))
+        {
+            m_reader.next();
+            continue;
+        }
+        if(!readValue(map[key], depth))
+            return false;
+    }
+
+    m_reader.leaveContainer();
+    return checkError();
+}
+
+bool QCborArrayReader::readArray(QVariantList& list, int depth)
+{
+    if(!m_reader.enterContainer())
+        return checkError();
+
+    if(m_reader.isLengthKnown())
+        list.reserve(int(m_reader.length()));
+
+    while(m_reader.hasNext())
+    {
+        list.append(QVariant());
+        if(!readValue(list.last(), depth))
+            return false;
+    }
+
+    m_reader.leaveContainer();
+    return checkError();
+}
+
+bool QCborArrayReader::readString(QString& string)
+{
+    string.clear();
+    QCborStreamReader::StringResult<QString> chunk = m_reader.readString();
+    while(chunk.status == QCborStreamReader::Ok)
+    {
+        string += chunk.data;
+        chunk = m_reader.readString();
+    }
+
+    return chunk.status == QCborStreamReader::EndOfString ? true : checkError() && setError(QStringLiteral("truncated string"));
+}
+
+bool QCborArrayReader::readByteArray(QByteArray& bytes)
+{
+    bytes.clear();
+    QCborStreamReader::StringResult<QByteArray> chunk = m_reader.readByteArray();
+    while(chunk.status == QCborStreamReader::Ok)
+    {
+        bytes += chunk.data;
+        chunk = m_reader.readByteArray();
+    }
+
+    return chunk.status == QCborStreamReader::EndOfString ? true : checkError() && setError(QStringLiteral("truncated byte array"));
+}
+
+int QCborArrayReader::fieldColumn(const QString& key)
+{
+    int column = m_fieldIndexes.value(key, -1);
+    if(column >= 0 || m_projected)
+        return column;
+
+    column = m_fields.count();
+    m_fields.append(key);
+    m_fieldIndexes.insert(key, column);
+    return column;
+}
+
+bool QCborArrayReader::checkError()
+{
+    const QCborError error = m_reader.lastError();
+    if(error == QCborError::NoError)
+        return true;
+
+    return setError(error.toString());
+}
+
+bool QCborArrayReader::setError(const QString& error)
+{
+    m_error = error;
+    return false;
+}
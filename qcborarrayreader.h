@@ -0,0 +1,64 @@
+#ifndef QCBORARRAYREADER_H
+#define QCBORARRAYREADER_H
+
+#include <QCborStreamReader>
+#include <QHash>
+#include <QIODevice>
+#include <QStringList>
+#include <QVariant>
+
+#include "qvariantlistrows.h"
+
+// Reads the elements of a top level CBOR array one by one from a device,
+// without building QCborValue trees. Maps can be read into rows holding one value per field.
+class QCborArrayReader
+{
+public:
+    using Row = QVariantListRows::Row;
+
+    explicit QCborArrayReader(QIODevice* device);
+
+    // Reads the next element into item, returns false at the end of the array or on error
+    bool readNext(QVariant& item);
+    // Reads the next element into row when it is a map, with one value per field of fields(),
+    // and into item otherwise
+    bool readNextRow(Row& row, QVariant& item, bool& isObject);
+    const QStringList& fields() const { return m_fields; }
+    // Only keeps these fields of the top level maps, the values of the other keys are skipped
+    // without being decoded. Clears the fields discovered so far
+    void setProjection(const QStringList& fields);
+
+    bool hasError() const { return !m_error.isEmpty(); }
+    const QString& errorString() const { return m_error; }
+    // Number of bytes of the device consumed so far
+    qint64 position() const { return m_reader.currentOffset(); }
+
+    static const int MaxDepth = 1024;
+
+private:
+    bool nextElement();
+    bool readValue(QVariant& value, int depth);
+    bool readMap(QVariantMap& map, int depth);
+    bool readArray(QVariantList& list, int depth);
+    bool readString(QString& string);
+    int fieldColumn(const QString& key);
+    bool readByteArray(QByteArray& bytes);
+    bool checkError();
+    bool setError(const QString& error);
+
+    enum State {
+        BeforeArray,
+        InArray,
+        AfterArray
+    };
+
+    QCborStreamReader m_reader;
+    State m_state=BeforeArray;
+    QString m_error;
+
+    QStringList m_fields;
+    QHash<QString, int> m_fieldIndexes;
+    bool m_projected=false;
+};
+
+#endif // QCBORARRAYREADER_H
@@ -1,52 +1,303 @@
 #include "qcsvlistmodel.h"
+#include "qcsvreader.h"
+#include "qmappedfile.h"
 #include "qmodels_log.h"
 
+#include <QDate>
+
+#include <algorithm>
+
+// Quotes the fields holding a separator, a quote or a line break, as RFC 4180 requires
+static void appendField(QByteArray& csv, const QString& value, char separator)
+{
+    const QByteArray utf8 = value.toUtf8();
+    if(!utf8.contains(separator) && !utf8.contains('"') && !utf8.contains('\n') && !utf8.contains('\r'))
+    {
+        csv.append(utf8);
+        return;
+    }
+
+    csv.append('"');
+    for(const char c: utf8)
+    {
+        if(c == '"')
+            csv.append('"');
+        csv.append(c);
+    }
+    csv.append('"');
+}
+
 QCsvListModel::QCsvListModel(QObject *parent) :
-    QVariantListModel(parent)
+    QVariantListFileModel(parent)
 {
 
 }
 
 bool QCsvListModel::loadPath(const QString& fileName)
 {
-    QFile file(fileName);
+    // Reading a mapping after the file was truncated raises SIGBUS, a watched file is read by blocks
+    if(watch())
+    {
+        QFile file(fileName);
 
-    if (!file.open(QIODevice::ReadOnly))
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            QMODELSLOG_WARNING()<<"Error opening file:"<<file.errorString();
+            return false;
+        }
+
+        QCsvReader reader(&file, m_separator);
+        if(!loadData(reader))
+            return false;
+    }
+    else
     {
-        QMODELSLOG_WARNING()<<"Error opening file:"<<file.errorString();
-        return false;
+        // Parsed in place from the mapping of the file, without copying it
+        QMappedFile file(fileName);
+
+        if (!file.isOpen())
+        {
+            QMODELSLOG_WARNING()<<"Error opening file:"<<file.errorString();
+            return false;
+        }
+
+        QCsvReader reader(file.data(), file.size(), m_separator);
+        if(!loadData(reader))
+            return false;
     }
 
-    bool ret = loadCsv(file.readAll());
-    file.close();
+    setWatchedFile(fileName, pathParser(fileName));
+    return true;
+}
 
-    return ret;
+bool QCsvListModel::loadPathAsync(const QString& fileName)
+{
+    const auto parse = pathParser(fileName);
+    setWatchedFile(fileName, parse);
+    return loadAsync(parse);
+}
+
+std::function<bool(QVariantListLoader* loader)> QCsvListModel::pathParser(const QString& fileName) const
+{
+    const Format format = this->format();
+    return [fileName, format](QVariantListLoader* loader) {
+        // Read by blocks, the file may be rewritten while it is parsed
+        QFile file(fileName);
+
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            QMODELSLOG_WARNING()<<"Error opening file:"<<file.errorString();
+            return false;
+        }
+
+        // Rows and not maps, so that the columns keep the order of the file
+        QStringList fields;
+        QCsvReader reader(&file, format.separator);
+        const QVariantListLoader::RowSink sink = loader->rowSink(file.size());
+        return readCsv(reader, format, fields, [&fields, &sink](const Row& row, qint64 position) {
+            return sink(fields, row, position);
+        });
+    };
 }
 
 bool QCsvListModel::loadCsv(const QByteArray& csv)
 {
-    QTextStream fileStream(csv);
+    QCsvReader reader(csv.constData(), csv.size(), m_separator);
+    return loadData(reader);
+}
+
+bool QCsvListModel::loadData(QCsvReader& reader)
+{
+    QStringList fields;
+
+    // Matching the rows by key needs the items
+    if(!keyField().isEmpty() && count() > 0)
+    {
+        QVariantList storage;
+        if(!readCsv(reader, format(), fields, itemSink(fields, [&storage](const QVariant& item, qint64) { storage.append(item); return true; })))
+            return false;
+
+        appendFields(fields);
+        return setStorage(storage);
+    }
+
+    // The columns keep the order of the file
+    QVector<Row> rows;
+    if(!readCsv(reader, format(), fields, [&rows](const Row& row, qint64) { rows.append(row); return true; }))
+        return false;
+
+    return resetRows(fields, true, rows);
+}
 
-    QVariantList storage;
+bool QCsvListModel::readCsv(QCsvReader& reader, const Format& format, QStringList& fields, const RowSink& sink)
+{
+    QVector<QString> record;
+    fields.clear();
 
-    do
+    if(format.hasHeader && reader.readRecord(record))
     {
-        QString line = fileStream.readLine();
-        const QStringList values = line.split(m_separator);
+        for(int pos = 0; pos < record.count(); ++pos)
+            fields.append(uniqueField(fields, record.at(pos).isEmpty() ? QString("column_%1").arg(pos) : record.at(pos)));
+    }
+
+    // Fields and types are computed once per column, not per cell
+    QVector<ColumnType> types;
+    Row row;
+    const auto sinkRecord = [&](const QVector<QString>& values, qint64 position) {
+        row.resize(values.count());
+        for(int pos = 0; pos < values.count(); ++pos)
+        {
+            if(pos >= fields.count())
+                fields.append(uniqueField(fields, QString("column_%1").arg(pos)));
+            row[pos] = pos < types.count() ? convert(values.at(pos), types.at(pos)) : QVariant(values.at(pos));
+        }
+        return sink(row, position);
+    };
+
+    // The first records are kept aside until the types are inferred from them
+    QVector<QVector<QString>> sample;
+    bool sampling = format.inferTypes;
+    while(reader.readRecord(record))
+    {
+        if(!sampling)
+        {
+            if(!sinkRecord(record, reader.position()))
+                return false;
+            continue;
+        }
+
+        sample.append(record);
+        if(sample.count() < TypeSampleSize)
+            continue;
+
+        types = columnTypes(sample);
+        sampling = false;
+        for(const QVector<QString>& values: qAsConst(sample))
+        {
+            if(!sinkRecord(values, reader.position()))
+                return false;
+        }
+        sample.clear();
+    }
+
+    if(sampling)
+    {
+        types = columnTypes(sample);
+        for(const QVector<QString>& values: qAsConst(sample))
+        {
+            if(!sinkRecord(values, reader.position()))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+QString QCsvListModel::uniqueField(const QStringList& fields, const QString& field)
+{
+    // A repeated name would merge its column into the first one, it gets a suffix instead
+    QString ret = field;
+    for(int suffix = 2; fields.contains(ret); ++suffix)
+        ret = QString("%1_%2").arg(field).arg(suffix);
+    return ret;
+}
+
+QCsvListModel::RowSink QCsvListModel::itemSink(const QStringList& fields, const QVariantListLoader::Sink& sink)
+{
+    const QStringList* keys = &fields;
+    return [keys, sink](const Row& row, qint64 position) {
         QVariantMap map;
-        int pos=0;
+        for(int pos = 0; pos < row.count(); ++pos)
+        {
+            if(row.at(pos).isValid())
+                map.insert(keys->at(pos), row.at(pos));
+        }
+        return sink(map, position);
+    };
+}
 
-        for(const QString& value: values)
+QVector<QCsvListModel::ColumnType> QCsvListModel::columnTypes(const QVector<QVector<QString>>& sample)
+{
+    static const QVector<ColumnType> candidates = {IntColumn, DoubleColumn, BoolColumn, DateColumn};
+
+    int columnCount = 0;
+    for(const QVector<QString>& values: sample)
+        columnCount = qMax(columnCount, values.count());
+
+    // A column gets the first type every non empty value of the sample converts to
+    QVector<ColumnType> ret(columnCount, StringColumn);
+    for(int column = 0; column < columnCount; ++column)
+    {
+        QVector<ColumnType> types = candidates;
+        bool empty = true;
+        for(const QVector<QString>& values: sample)
         {
-            map.insert(QString("column_%1").arg(pos), value);
-            pos++;
+            if(column >= values.count() || values.at(column).isEmpty())
+                continue;
+
+            empty = false;
+            types.erase(std::remove_if(types.begin(), types.end(), [&values, column](ColumnType type) {
+                return convert(values.at(column), type).userType() == QMetaType::QString;
+            }), types.end());
+            if(types.isEmpty())
+                break;
         }
 
-        storage.append(map);
+        if(!empty && !types.isEmpty())
+            ret[column] = types.first();
     }
-    while(!fileStream.atEnd());
 
-    return setStorage(storage);
+    return ret;
+}
+
+QVariant QCsvListModel::convert(const QString& value, ColumnType type)
+{
+    if(type == StringColumn)
+        return value;
+    if(value.isEmpty())
+        return QVariant();
+
+    bool ok=false;
+    switch(type)
+    {
+    case IntColumn:
+    {
+        const qlonglong number = value.toLongLong(&ok);
+        if(ok)
+            return number;
+        break;
+    }
+    case DoubleColumn:
+    {
+        const double number = value.toDouble(&ok);
+        if(ok)
+            return number;
+        break;
+    }
+    case BoolColumn:
+        if(value.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0)
+            return true;
+        if(value.compare(QLatin1String("false"), Qt::CaseInsensitive) == 0)
+            return false;
+        break;
+    case DateColumn:
+    {
+        const QDate date = QDate::fromString(value, Qt::ISODate);
+        if(date.isValid())
+            return date;
+        break;
+    }
+    default:
+        break;
+    }
+
+    // Values that don't fit the type of their column stay strings
+    return value;
+}
+
+QCsvListModel::Format QCsvListModel::format() const
+{
+    return Format{m_separator, m_hasHeader, m_inferTypes};
 }
 
 bool QCsvListModel::syncPath(const QString& fileName) const
@@ -68,20 +319,52 @@ bool QCsvListModel::syncPath(const QString& fileName) const
 QByteArray QCsvListModel::toCsv() const
 {
     QByteArray csv;
+    const QVariantListSnapshot rows = snapshot();
 
-    for(const QVariant& variant: storage())
+    // Items stored as maps are written in the order of their keys, first seen first
+    QStringList fields = rows.fields();
+    if(!rows.isColumnar())
     {
-        QByteArray csvLine;
-        const QVariantMap values = variant.toMap();
-        for (QVariantMap::const_iterator it = values.begin(); it != values.end(); ++it)
+        fields.clear();
+        for(int i = 0; i < rows.count(); ++i)
         {
-            csvLine.append(it.value().toString());
-            csvLine.append(separator());
+            if(const QVariantMap* map = mapView(rows.rows().at(i).value(0)))
+            {
+                for(QVariantMap::const_iterator it = map->cbegin(); it != map->cend(); ++it)
+                {
+                    if(!fields.contains(it.key()))
+                        fields.append(it.key());
+                }
+            }
         }
-        csvLine.chop(1);
-        csvLine.append('\n');
+    }
 
-        csv.append(csvLine);
+    const auto appendLine = [&csv, this](const QVector<QString>& values) {
+        for(const QString& value: values)
+        {
+            appendField(csv, value, separator());
+            csv.append(separator());
+        }
+        if(!values.isEmpty())
+            csv.chop(1);
+        csv.append('\n');
+    };
+
+    if(m_hasHeader)
+        appendLine(fields.toVector());
+
+    // The values are written in the order of the fields, empty when a row doesn't have one
+    QVector<QString> values(fields.count());
+    for(int i = 0; i < rows.count(); ++i)
+    {
+        const Row& row = rows.rows().at(i);
+        const QVariantMap* map = rows.isColumnar() ? nullptr : mapView(row.value(0));
+        for(int column = 0; column < fields.count(); ++column)
+        {
+            const QVariant value = map ? map->value(fields.at(column)) : row.value(column);
+            values[column] = value.userType() == QMetaType::QDate ? value.toDate().toString(Qt::ISODate) : value.toString();
+        }
+        appendLine(values);
     }
 
     return csv;
@@ -100,3 +383,31 @@ bool QCsvListModel::setSeparator(char separator)
     emit this->separatorChanged(m_separator);
     return true;
 }
+
+bool QCsvListModel::hasHeader() const
+{
+    return m_hasHeader;
+}
+
+bool QCsvListModel::setHasHeader(bool hasHeader)
+{
+    if(m_hasHeader==hasHeader)
+        return false;
+    m_hasHeader=hasHeader;
+    emit this->hasHeaderChanged(m_hasHeader);
+    return true;
+}
+
+bool QCsvListModel::inferTypes() const
+{
+    return m_inferTypes;
+}
+
+bool QCsvListModel::setInferTypes(bool inferTypes)
+{
+    if(m_inferTypes==inferTypes)
+        return false;
+    m_inferTypes=inferTypes;
+    emit this->inferTypesChanged(m_inferTypes);
+    return true;
+}
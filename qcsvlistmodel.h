@@ -1,33 +1,82 @@
 #ifndef QCSVLISTMODEL_H
 #define QCSVLISTMODEL_H
 
-#include "qvariantlistmodel.h"
+#include "qvariantlistfilemodel.h"
 
-class QCsvListModel: public QVariantListModel
+class QCsvReader;
+
+class QCsvListModel: public QVariantListFileModel
 {
     Q_OBJECT
     QML_NAMED_ELEMENT(CsvListModel)
 
     Q_PROPERTY(char separator READ separator WRITE setSeparator NOTIFY separatorChanged)
+    Q_PROPERTY(bool hasHeader READ hasHeader WRITE setHasHeader NOTIFY hasHeaderChanged)
+    Q_PROPERTY(bool inferTypes READ inferTypes WRITE setInferTypes NOTIFY inferTypesChanged)
 
 public:
     explicit QCsvListModel(QObject * parent = nullptr);
 
     char separator() const;
     bool setSeparator(char separator);
+    // The first record holds the fields of the columns
+    bool hasHeader() const;
+    bool setHasHeader(bool hasHeader);
+    // Columns holding only integers, numbers, booleans or ISO dates store typed values
+    bool inferTypes() const;
+    bool setInferTypes(bool inferTypes);
 
     Q_INVOKABLE bool syncPath(const QString& path) const;
     Q_INVOKABLE QByteArray toCsv() const;
 
+    // Records read to infer the type of the columns
+    static const int TypeSampleSize = 100;
+
 public slots:
     bool loadPath(const QString& path);
+    bool loadPathAsync(const QString& path);
     bool loadCsv(const QByteArray& csv);
 
 signals:
     void separatorChanged(char separator);
+    void hasHeaderChanged(bool hasHeader);
+    void inferTypesChanged(bool inferTypes);
+
+protected:
+    struct Format {
+        char separator;
+        bool hasHeader;
+        bool inferTypes;
+    };
+
+    using RowSink = std::function<bool(const Row& row, qint64 position)>;
+
+    // Calls sink with the values of every record, fields holding the field of each value
+    static bool readCsv(QCsvReader& reader, const Format& format, QStringList& fields, const RowSink& sink);
+    // Calls sink with the map of every record
+    static RowSink itemSink(const QStringList& fields, const QVariantListLoader::Sink& sink);
 
 private:
+    enum ColumnType {
+        StringColumn,
+        IntColumn,
+        DoubleColumn,
+        BoolColumn,
+        DateColumn
+    };
+
+    static QVector<ColumnType> columnTypes(const QVector<QVector<QString>>& sample);
+    static QVariant convert(const QString& value, ColumnType type);
+    static QString uniqueField(const QStringList& fields, const QString& field);
+
+    Format format() const;
+    bool loadData(QCsvReader& reader);
+    // Parses the file on the thread pool, for loadPathAsync() and the reloads of watch
+    std::function<bool(QVariantListLoader* loader)> pathParser(const QString& path) const;
+
     char m_separator=';';
+    bool m_hasHeader=false;
+    bool m_inferTypes=false;
 };
 
 #endif // QCSVLISTMODEL_H
@@ -0,0 +1,191 @@
+#include "qcsvreader.h"
+
+#include <cstring>
+
+namespace QCsvReaderFunctions
+{
+    const quint64 Ones = ~quint64(0) / 255;
+    const quint64 Highs = Ones * 0x80;
+
+    // True when one of the bytes of word equals c
+    inline bool hasByte(quint64 word, char c)
+    {
+        const quint64 x = word ^ (Ones * uchar(c));
+        return ((x - Ones) & ~x & Highs) != 0;
+    }
+
+    // End of the last record of the text starting at a record start, begin when it holds no whole record.
+    // A line break ends a record when an even number of quotes precedes it, doubled quotes counting twice
+    const char* recordsEnd(const char* begin, const char* end, bool atEnd)
+    {
+        if(atEnd)
+            return end;
+
+        // A CR at the end may be followed by the LF of the next block
+        if(end > begin && end[-1] == '\r')
+            --end;
+
+        int quotes = 0;
+        for(const char* it = begin; (it = static_cast<const char*>(std::memchr(it, '"', size_t(end - it)))); ++it)
+            ++quotes;
+
+        for(const char* it = end; it > begin; --it)
+        {
+            const char c = it[-1];
+            if(c == '"')
+                --quotes;
+            else if((c == '\n' || c == '\r') && quotes % 2 == 0)
+                return it;
+        }
+        return begin;
+    }
+}
+
+using namespace QCsvReaderFunctions;
+
+QCsvReader::QCsvReader(QIODevice* device, char separator) :
+    m_data(nullptr),
+    m_end(nullptr),
+    m_pos(nullptr),
+    m_separator(separator),
+    m_device(device)
+{
+    fill();
+    skipByteOrderMark();
+}
+
+QCsvReader::QCsvReader(const char* data, qint64 size, char separator) :
+    m_data(data),
+    m_end(data + size),
+    m_pos(data),
+    m_separator(separator)
+{
+    skipByteOrderMark();
+}
+
+void QCsvReader::skipByteOrderMark()
+{
+    if(m_end - m_pos >= 3 && std::memcmp(m_pos, "\xEF\xBB\xBF", 3) == 0)
+        m_pos += 3;
+}
+
+bool QCsvReader::readRecord(QVector<QString>& fields)
+{
+    fields.resize(0);
+    if(m_pos >= m_end && !fill())
+        return false;
+
+    forever
+    {
+        fields.append(m_pos < m_end && *m_pos == '"' ? readQuoted() : readUnquoted());
+
+        if(m_pos >= m_end)
+            return true;
+
+        const char c = *m_pos++;
+        if(c == m_separator)
+            continue;
+
+        if(c == '\r' && m_pos < m_end && *m_pos == '\n')
+            ++m_pos;
+        return true;
+    }
+}
+
+bool QCsvReader::fill()
+{
+    if(!m_device)
+        return false;
+
+    // The records already read are dropped, the start of the next one is kept
+    const int consumed = int(m_pos - m_data);
+    m_buffer.remove(0, consumed);
+    m_offset += consumed;
+
+    bool atEnd = false;
+    const char* end;
+    do
+    {
+        QByteArray block = m_device->read(BlockSize);
+        if(block.isEmpty() && m_device->isSequential() && m_device->waitForReadyRead(-1))
+            block = m_device->read(BlockSize);
+
+        atEnd = block.isEmpty();
+        m_buffer.append(block);
+        end = recordsEnd(m_buffer.constData(), m_buffer.constData() + m_buffer.size(), atEnd);
+    }
+    while(end == m_buffer.constData() && !atEnd);
+
+    m_data = m_buffer.constData();
+    m_pos = m_data;
+    m_end = end;
+    if(atEnd)
+        m_device = nullptr;
+
+    return m_pos < m_end;
+}
+
+QString QCsvReader::readQuoted()
+{
+    const char* begin = ++m_pos;
+    const char* quote = static_cast<const char*>(std::memchr(begin, '"', size_t(m_end - begin)));
+
+    // Common case, nothing to unescape
+    if(quote && (quote + 1 == m_end || isFieldEnd(quote[1])))
+    {
+        m_pos = quote + 1;
+        return QString::fromUtf8(begin, int(quote - begin));
+    }
+
+    QByteArray field;
+    forever
+    {
+        if(!quote)
+        {
+            field.append(begin, int(m_end - begin));
+            m_pos = m_end;
+            return QString::fromUtf8(field);
+        }
+
+        if(quote + 1 < m_end && quote[1] == '"')
+        {
+            field.append(begin, int(quote + 1 - begin));
+            begin = quote + 2;
+            quote = static_cast<const char*>(std::memchr(begin, '"', size_t(m_end - begin)));
+            continue;
+        }
+
+        field.append(begin, int(quote - begin));
+        break;
+    }
+
+    const char* end = fieldEnd(quote + 1);
+    field.append(quote + 1, int(end - quote - 1));
+    m_pos = end;
+
+    return QString::fromUtf8(field);
+}
+
+QString QCsvReader::readUnquoted()
+{
+    const char* begin = m_pos;
+    m_pos = fieldEnd(begin);
+    return QString::fromUtf8(begin, int(m_pos - begin));
+}
+
+const char* QCsvReader::fieldEnd(const char* it) const
+{
+    // Eight bytes at a time while none of them ends the field
+    while(m_end - it >= 8)
+    {
+        quint64 word;
+        std::memcpy(&word, it, sizeof(word));
+        if(hasByte(word, m_separator) || hasByte(word, '\n') || hasByte(word, '\r'))
+            break;
+        it += 8;
+    }
+
+    while(it < m_end && !isFieldEnd(*it))
+        ++it;
+    return it;
+}
@@ -0,0 +1,48 @@
+#ifndef QCSVREADER_H
+#define QCSVREADER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <QVector>
+
+// Splits RFC 4180 CSV text into records of fields, straight from the UTF-8 bytes.
+// Quoted fields may hold separators, line breaks and doubled quotes. Records end with LF, CRLF or CR.
+// The reader is lenient: an unterminated quoted field runs to the end of the text
+// and text after a closing quote is kept in the field.
+class QCsvReader
+{
+public:
+    // Reads the device by blocks, only the records not read yet of the last block are kept in memory
+    QCsvReader(QIODevice* device, char separator);
+    // Parses in place, the data must outlive the reader
+    QCsvReader(const char* data, qint64 size, char separator);
+
+    // Reads the fields of the next record, returns false at the end of the text
+    bool readRecord(QVector<QString>& fields);
+    // Number of bytes consumed so far
+    qint64 position() const { return m_offset + (m_pos - m_data); }
+
+    static const int BlockSize = 1 << 16;
+
+private:
+    // Reads blocks until the buffer holds a whole record, the parsed text stops after the last one
+    bool fill();
+    void skipByteOrderMark();
+
+    QString readQuoted();
+    QString readUnquoted();
+    const char* fieldEnd(const char* it) const;
+    bool isFieldEnd(char c) const { return c == m_separator || c == '\n' || c == '\r'; }
+
+    const char* m_data;
+    const char* m_end;
+    const char* m_pos;
+    char m_separator;
+
+    QIODevice* m_device=nullptr;
+    QByteArray m_buffer;
+    qint64 m_offset=0;
+};
+
+#endif // QCSVREADER_H
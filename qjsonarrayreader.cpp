@@ -0,0 +1,209 @@
+#include "qjsonarrayreader.h"
+
+#include <cstring>
+
+QJsonArrayReader::QJsonArrayReader(QIODevice* device) :
+    m_device(device)
+{
+
+}
+
+QJsonArrayReader::QJsonArrayReader(const char* data, qint64 size) :
+    m_data(data),
+    m_size(size)
+{
+
+}
+
+bool QJsonArrayReader::readNext(QVariant& item)
+{
+    const char* begin;
+    const char* end;
+    if(!nextElement(begin, end))
+        return false;
+
+    if(!m_decoder.decode(begin, end, item))
+        return setError(m_decoder.errorString());
+
+    return true;
+}
+
+bool QJsonArrayReader::readNextRow(Row& row, QVariant& item, bool& isObject)
+{
+    const char* begin;
+    const char* end;
+    if(!nextElement(begin, end))
+        return false;
+
+    isObject = m_decoder.decodeRow(begin, end, row);
+    if(isObject)
+        return true;
+    if(!m_decoder.errorString().isEmpty())
+        return setError(m_decoder.errorString());
+
+    row.clear();
+    if(!m_decoder.decode(begin, end, item))
+        return setError(m_decoder.errorString());
+
+    return true;
+}
+
+bool QJsonArrayReader::nextElement(const char*& begin, const char*& end)
+{
+    if(m_state == AfterArray || hasError())
+        return false;
+
+    // Drop the elements already parsed before reading more
+    if(m_device && m_pos > BlockSize)
+    {
+        m_buffer.remove(0, int(m_pos));
+        m_data = m_buffer.constData();
+        m_size = m_buffer.size();
+        m_offset += m_pos;
+        m_pos = 0;
+    }
+
+    if(m_state == BeforeArray)
+    {
+        if(m_device)
+            fill();
+        if(m_size >= 3 && std::memcmp(m_data, "\xEF\xBB\xBF", 3) == 0)
+            m_pos = 3;
+
+        if(!skipWhitespace())
+            return setError(QStringLiteral("cannot load empty json"));
+        if(m_data[m_pos] != '[')
+            return setError(QStringLiteral("cannot load non array json"));
+        ++m_pos;
+        m_state = FirstElement;
+    }
+
+    if(!skipWhitespace())
+        return setError(QStringLiteral("unterminated array"));
+
+    if(m_data[m_pos] == ']')
+    {
+        ++m_pos;
+        m_state = AfterArray;
+        return false;
+    }
+
+    if(m_state == NextElement)
+    {
+        if(m_data[m_pos] != ',')
+            return setError(QStringLiteral("missing comma between array elements"));
+        ++m_pos;
+        if(!skipWhitespace())
+            return setError(QStringLiteral("unterminated array"));
+    }
+
+    const qint64 last = elementEnd();
+    if(last < 0)
+        return false;
+
+    // The element stays valid in the buffer until the next call
+    begin = m_data + m_pos;
+    end = m_data + last;
+    m_pos = last;
+    m_state = NextElement;
+
+    return true;
+}
+
+bool QJsonArrayReader::fill()
+{
+    if(!m_device)
+        return false;
+
+    QByteArray block = m_device->read(BlockSize);
+    if(block.isEmpty() && m_device->isSequential() && m_device->waitForReadyRead(-1))
+        block = m_device->read(BlockSize);
+
+    if(block.isEmpty())
+        return false;
+
+    m_buffer.append(block);
+    m_data = m_buffer.constData();
+    m_size = m_buffer.size();
+    return true;
+}
+
+bool QJsonArrayReader::skipWhitespace()
+{
+    forever
+    {
+        if(m_pos >= m_size && !fill())
+            return false;
+
+        const char c = m_data[m_pos];
+        if(c != ' ' && c != '\t' && c != '\n' && c != '\r')
+            return true;
+        ++m_pos;
+    }
+}
+
+qint64 QJsonArrayReader::elementEnd()
+{
+    // Only strings and nesting matter to find where the element ends, the parser checks the rest
+    int depth = 0;
+    bool inString = false;
+    bool escaped = false;
+    for(qint64 i = m_pos; ; ++i)
+    {
+        if(i >= m_size && !fill())
+        {
+            setError(QStringLiteral("unterminated array"));
+            return -1;
+        }
+
+        const char c = m_data[i];
+        if(inString)
+        {
+            if(escaped)
+                escaped = false;
+            else if(c == '\\')
+                escaped = true;
+            else if(c == '"')
+            {
+                inString = false;
+                if(depth == 0)
+                    return i + 1;
+            }
+            continue;
+        }
+
+        switch(c)
+        {
+        case '"':
+            inString = true;
+            break;
+        case '{':
+        case '[':
+            ++depth;
+            break;
+        case '}':
+        case ']':
+            if(depth == 0)
+                return i;
+            if(--depth == 0)
+                return i + 1;
+            break;
+        case ',':
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            if(depth == 0)
+                return i;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool QJsonArrayReader::setError(const QString& error)
+{
+    m_error = error;
+    return false;
+}
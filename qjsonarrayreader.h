@@ -0,0 +1,66 @@
+#ifndef QJSONARRAYREADER_H
+#define QJSONARRAYREADER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <QVariant>
+
+#include "qjsonrowdecoder.h"
+
+// Reads the elements of a top level JSON array one by one from a device or from memory.
+// The device is read by blocks, only the element being parsed is kept in memory.
+class QJsonArrayReader
+{
+public:
+    using Row = QJsonRowDecoder::Row;
+
+    explicit QJsonArrayReader(QIODevice* device);
+    // Parses in place, the data must outlive the reader
+    QJsonArrayReader(const char* data, qint64 size);
+
+    // Parses the next element into item, returns false at the end of the array or on error
+    bool readNext(QVariant& item);
+    // Parses the next element into row when it is an object, with one value per field of fields(),
+    // and into item otherwise
+    bool readNextRow(Row& row, QVariant& item, bool& isObject);
+    const QStringList& fields() const { return m_decoder.fields(); }
+    // See QJsonRowDecoder::setProjection()
+    void setProjection(const QStringList& fields) { m_decoder.setProjection(fields); }
+    // See QJsonRowDecoder::setInternStrings()
+    void setInternStrings(bool internStrings) { m_decoder.setInternStrings(internStrings); }
+
+    bool hasError() const { return !m_error.isEmpty(); }
+    const QString& errorString() const { return m_error; }
+    // Number of bytes of the device consumed so far
+    qint64 position() const { return m_offset + m_pos; }
+
+    static const int BlockSize = 1 << 16;
+
+private:
+    bool nextElement(const char*& begin, const char*& end);
+    bool fill();
+    bool skipWhitespace();
+    qint64 elementEnd();
+    bool setError(const QString& error);
+
+    enum State {
+        BeforeArray,
+        FirstElement,
+        NextElement,
+        AfterArray
+    };
+
+    QIODevice* m_device=nullptr;
+    State m_state=BeforeArray;
+    // Parsed text, m_buffer when reading from a device
+    QByteArray m_buffer;
+    const char* m_data=nullptr;
+    qint64 m_size=0;
+    qint64 m_pos=0;
+    qint64 m_offset=0;
+    QString m_error;
+    QJsonRowDecoder m_decoder;
+};
+
+#endif // QJSONARRAYREADER_H
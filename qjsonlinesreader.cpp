@@ -0,0 +1,105 @@
+#include "qjsonlinesreader.h"
+#include "qjsonrowdecoder.h"
+
+#include <QThread>
+
+#include <cstring>
+#include <future>
+#include <vector>
+
+bool QJsonLinesReader::read(const char* begin, const char* end, QVariantList& items)
+{
+    m_error.clear();
+    if(end - begin >= 3 && std::memcmp(begin, "\xEF\xBB\xBF", 3) == 0)
+        begin += 3;
+
+    const qint64 size = end - begin;
+    const int chunkCount = int(qBound<qint64>(1, size / ParallelThreshold, QThread::idealThreadCount()));
+
+    // Every chunk but the last one ends after a line break
+    QVector<Chunk> chunks(chunkCount);
+    const char* chunkBegin = begin;
+    for(int i = 0; i < chunkCount; ++i)
+    {
+        const char* chunkEnd = end;
+        if(i < chunkCount - 1)
+        {
+            chunkEnd = qMax(chunkBegin, begin + size * (i + 1) / chunkCount);
+            const char* lineBreak = static_cast<const char*>(std::memchr(chunkEnd, '\n', size_t(end - chunkEnd)));
+            chunkEnd = lineBreak ? lineBreak + 1 : end;
+        }
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    if(chunkCount == 1)
+    {
+        parseChunk(chunks[0], m_projection, m_internStrings);
+    }
+    else
+    {
+        std::vector<std::future<void>> tasks;
+        for(int i = 0; i < chunkCount; ++i)
+        {
+            Chunk* chunk = &chunks[i];
+            const QStringList& projection = m_projection;
+            const bool internStrings = m_internStrings;
+            tasks.push_back(std::async(std::launch::async, [chunk, &projection, internStrings]() { parseChunk(*chunk, projection, internStrings); }));
+        }
+        for(std::future<void>& task: tasks)
+            task.wait();
+    }
+
+    int itemCount = 0;
+    for(const Chunk& chunk: qAsConst(chunks))
+        itemCount += chunk.items.count();
+    items.reserve(items.count() + itemCount);
+
+    int line = 0;
+    for(const Chunk& chunk: qAsConst(chunks))
+    {
+        if(!chunk.error.isEmpty())
+        {
+            m_error = QStringLiteral("line %1: %2").arg(line + chunk.lines).arg(chunk.error);
+            return false;
+        }
+        line += chunk.lines;
+        items.append(chunk.items);
+    }
+
+    return true;
+}
+
+void QJsonLinesReader::parseChunk(Chunk& chunk, const QStringList& projection, bool internStrings)
+{
+    // One decoder per chunk, its key and string caches are not shared between threads
+    QJsonRowDecoder decoder;
+    decoder.setProjection(projection);
+    decoder.setInternStrings(internStrings);
+    const char* line = chunk.begin;
+    while(line < chunk.end)
+    {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', size_t(chunk.end - line)));
+        if(!lineEnd)
+            lineEnd = chunk.end;
+        ++chunk.lines;
+
+        const char* it = line;
+        while(it < lineEnd && (*it == ' ' || *it == '\t' || *it == '\r'))
+            ++it;
+
+        if(it < lineEnd)
+        {
+            QVariant item;
+            if(!decoder.decode(it, lineEnd, item))
+            {
+                chunk.error = decoder.errorString();
+                return;
+            }
+            chunk.items.append(item);
+        }
+
+        line = lineEnd + 1;
+    }
+}
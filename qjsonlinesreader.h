@@ -0,0 +1,40 @@
+#ifndef QJSONLINESREADER_H
+#define QJSONLINESREADER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+// Parses JSON Lines text, one JSON value per line, blank lines being skipped.
+// Large texts are cut at line breaks into chunks parsed in parallel.
+class QJsonLinesReader
+{
+public:
+    bool read(const char* begin, const char* end, QVariantList& items);
+    const QString& errorString() const { return m_error; }
+    // See QJsonRowDecoder::setProjection()
+    void setProjection(const QStringList& fields) { m_projection = fields; }
+    // See QJsonRowDecoder::setInternStrings()
+    void setInternStrings(bool internStrings) { m_internStrings = internStrings; }
+
+    // Below this size per thread, the text is parsed on the calling thread
+    static const int ParallelThreshold = 1 << 20;
+
+private:
+    struct Chunk {
+        const char* begin=nullptr;
+        const char* end=nullptr;
+        QVariantList items;
+        int lines=0;
+        QString error;
+    };
+
+    static void parseChunk(Chunk& chunk, const QStringList& projection, bool internStrings);
+
+    QString m_error;
+    QStringList m_projection;
+    bool m_internStrings=true;
+};
+
+#endif // QJSONLINESREADER_H
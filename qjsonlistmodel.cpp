@@ -1,71 +1,733 @@
 #include "qjsonlistmodel.h"
+#include "qcborarrayreader.h"
+#include "qjsonarrayreader.h"
+#include "qjsonlistwriter.h"
+#include "qjsonlinesreader.h"
+#include "qmappedfile.h"
 #include "qmodels_log.h"
 
-QJsonListModel::QJsonListModel(QObject *parent) :
-    QVariantListModel(parent)
+#include <QBuffer>
+#include <QCborStreamWriter>
+#include <QCborValue>
+#include <QCoreApplication>
+#include <QFileSystemWatcher>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+
+static QVariantMap toMap(const QStringList& fields, const QVector<QVariant>& row)
+{
+    QVariantMap map;
+    for(int column = 0; column < row.count(); ++column)
+    {
+        if(row.at(column).isValid())
+            map.insert(fields.at(column), row.at(column));
+    }
+    return map;
+}
+
+// Parses the complete lines from the position of the device, returns in size the number of bytes they take.
+// The device is read by blocks large enough for the lines of each to be parsed in parallel
+static bool readCompleteLines(QIODevice& device, QJsonLinesReader& reader, QVariantList& items, qint64& size)
 {
+    const qint64 blockSize = qint64(QJsonLinesReader::ParallelThreshold) * QThread::idealThreadCount();
+    QByteArray buffer;
+    size = 0;
+    forever
+    {
+        const QByteArray block = device.read(blockSize);
+        if(block.isEmpty())
+            return true;
 
+        buffer.append(block);
+        const int end = buffer.lastIndexOf('\n') + 1;
+        if(end == 0)
+            continue;
+
+        // Lines failing to parse are skipped too, the next read starts after them
+        const bool ok = reader.read(buffer.constData(), buffer.constData() + end, items);
+        size += end;
+        buffer.remove(0, end);
+        if(!ok)
+            return false;
+    }
+}
+
+QJsonListModel::QJsonListModel(QObject *parent) :
+    QVariantListFileModel(parent)
+{
+    connect(this, &QVariantListModel::storageUpdated, this, &QJsonListModel::onStorageUpdated);
 }
 
 bool QJsonListModel::loadPath(const QString& fileName)
 {
-    QFile file(fileName);
+    // Reading a mapping after the file was truncated raises SIGBUS, a watched file is read by blocks
+    if(watch())
+    {
+        QFile file(fileName);
 
-    if (!file.open(QIODevice::ReadOnly))
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            QMODELSLOG_WARNING()<<"Error opening file:"<<file.errorString();
+            return false;
+        }
+
+        QJsonArrayReader reader(&file);
+        if(!loadArray(reader))
+            return false;
+    }
+    else
     {
-        QMODELSLOG_WARNING()<<"Error opening file:"<<file.errorString();
+        // Parsed in place from the mapping of the file, without copying it
+        QMappedFile file(fileName);
+
+        if (!file.isOpen())
+        {
+            QMODELSLOG_WARNING()<<"Error opening file:"<<file.errorString();
+            return false;
+        }
+
+        QJsonArrayReader reader(file.data(), file.size());
+        if(!loadArray(reader))
+            return false;
+    }
+
+    setWatchedFile(fileName, pathParser(fileName));
+    return true;
+}
+
+bool QJsonListModel::loadPathAsync(const QString& fileName)
+{
+    const auto parse = pathParser(fileName);
+    setWatchedFile(fileName, parse);
+    return loadAsync(parse);
+}
+
+std::function<bool(QVariantListLoader* loader)> QJsonListModel::pathParser(const QString& fileName) const
+{
+    const QStringList projection = this->projection();
+    const bool internStrings = this->internStrings();
+    return [fileName, projection, internStrings](QVariantListLoader* loader) {
+        // Read by blocks, the file may be rewritten while it is parsed
+        QFile file(fileName);
+
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            QMODELSLOG_WARNING()<<"Error opening file:"<<file.errorString();
+            return false;
+        }
+
+        QJsonArrayReader reader(&file);
+        reader.setProjection(projection);
+        reader.setInternStrings(internStrings);
+        return readJsonRows(reader, loader, file.size());
+    };
+}
+
+bool QJsonListModel::loadJson(const QByteArray& json)
+{
+    QJsonArrayReader reader(json.constData(), json.size());
+    return loadArray(reader);
+}
+
+bool QJsonListModel::loadDevice(QIODevice* device)
+{
+    QJsonArrayReader reader(device);
+    return loadArray(reader);
+}
+
+bool QJsonListModel::loadArray(QJsonArrayReader& reader)
+{
+    reader.setProjection(projection());
+    reader.setInternStrings(internStrings());
+
+    // Matching the rows by key needs the items
+    if(!keyField().isEmpty())
+    {
+        QVariantList storage;
+        if(!readJson(reader, [&storage](const QVariant& item, qint64) { storage.append(item); return true; }))
+            return false;
+
+        return setStorage(storage);
+    }
+
+    QVector<Row> rows;
+    bool columnar;
+    readRows([&reader](Row& row, QVariant& item, bool& isObject) { return reader.readNextRow(row, item, isObject); },
+             reader.fields(), rows, columnar);
+
+    if(reader.hasError())
+    {
+        QMODELSLOG_WARNING()<<"Error loading json:"<<reader.errorString();
         return false;
     }
 
-    bool ret = loadJson(file.readAll());
-    file.close();
+    return resetRows(columnar ? reader.fields() : QStringList(), columnar, rows);
+}
+
+bool QJsonListModel::readJson(QJsonArrayReader& reader, const QVariantListLoader::Sink& sink)
+{
+    // The elements are parsed one at a time, the whole document is never held in memory
+    QVariant item;
+    while(reader.readNext(item))
+    {
+        if(!sink(item, reader.position()))
+            return false;
+    }
+
+    if(reader.hasError())
+    {
+        QMODELSLOG_WARNING()<<"Error loading json:"<<reader.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool QJsonListModel::readJsonRows(QJsonArrayReader& reader, QVariantListLoader* loader, qint64 total)
+{
+    // Objects are decoded into rows on the pool thread, the model only stores them.
+    // The first element decides whether the elements are loaded as rows or as items
+    const QVariantListLoader::RowSink rowSink = loader->rowSink(total);
+    const QVariantListLoader::Sink sink = loader->sink(total);
+    bool schemaKnown = false;
+    bool columnar = false;
+    Row row;
+    QVariant item;
+    bool isObject;
+    while(reader.readNextRow(row, item, isObject))
+    {
+        if(!schemaKnown)
+        {
+            columnar = isObject;
+            schemaKnown = true;
+        }
+
+        bool ok;
+        if(columnar && !isObject)
+        {
+            QMODELSLOG_WARNING() << "cannot store a non map item in a model with fields:" << item;
+            ok = true;
+        }
+        else if(columnar)
+        {
+            ok = rowSink(reader.fields(), row, reader.position());
+        }
+        else
+        {
+            ok = sink(isObject ? QVariant(toMap(reader.fields(), row)) : item, reader.position());
+        }
+
+        if(!ok)
+            return false;
+    }
+
+    if(reader.hasError())
+    {
+        QMODELSLOG_WARNING()<<"Error loading json:"<<reader.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool QJsonListModel::syncPath(const QString& fileName, QJsonListModel::JsonFormat format) const
+{
+    return writeJson(fileName, snapshot(), format);
+}
+
+bool QJsonListModel::syncPathAsync(const QString& fileName, QJsonListModel::JsonFormat format)
+{
+    // The snapshot keeps the rows of this version while the model changes, the model may be gone when it ends
+    const QVariantListSnapshot rows = snapshot();
+    const QPointer<QJsonListModel> model = this;
+    QThreadPool::globalInstance()->start([fileName, rows, format, model]() {
+        const bool ok = writeJson(fileName, rows, format);
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [fileName, ok, model]() {
+            if(model)
+                emit model->pathSynced(fileName, ok);
+        }, Qt::QueuedConnection);
+    });
+
+    return true;
+}
+
+QByteArray QJsonListModel::toJson(QJsonListModel::JsonFormat format) const
+{
+    QByteArray ret;
+    QBuffer buffer(&ret);
+    buffer.open(QIODevice::WriteOnly);
+
+    QJsonListWriter writer(&buffer, format == Compact);
+    writer.write(snapshot());
 
     return ret;
 }
 
-bool QJsonListModel::loadJson(const QByteArray& json)
+bool QJsonListModel::writeJson(const QString& fileName, const QVariantListSnapshot& snapshot, QJsonListModel::JsonFormat format)
 {
-    QJsonParseError parseError;
-    const QJsonDocument& jdoc = QJsonDocument::fromJson(json, &parseError);
+    QSaveFile file(fileName);
 
-    if (parseError.error != QJsonParseError::NoError)
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
     {
-        QMODELSLOG_WARNING()<<"Error loading json:"<<parseError.errorString();
+        QMODELSLOG_WARNING()<<"cannot open file:"<<fileName;
         return false;
     }
 
-    if (jdoc.isNull())
+    // Rows are written by chunks, the file only replaces the previous one once complete
+    QJsonListWriter writer(&file, format == Compact);
+    if(!writer.write(snapshot))
     {
-        QMODELSLOG_WARNING()<<"cannot load json";
+        QMODELSLOG_WARNING()<<"cannot write file:"<<file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+bool QJsonListModel::loadLinesPath(const QString& fileName)
+{
+    stopTail();
+    return loadLinesFile(fileName, false);
+}
+
+bool QJsonListModel::loadLines(const QByteArray& lines)
+{
+    QJsonLinesReader reader;
+    reader.setProjection(projection());
+    reader.setInternStrings(internStrings());
+    QVariantList storage;
+    if(!reader.read(lines.constData(), lines.constData() + lines.size(), storage))
+    {
+        QMODELSLOG_WARNING()<<"Error loading json lines:"<<reader.errorString();
+        return false;
+    }
+
+    stopTail();
+    m_linesPath.clear();
+    m_linesCount = -1;
+
+    return setStorage(storage);
+}
+
+bool QJsonListModel::syncLinesPath(const QString& fileName)
+{
+    if(fileName == m_linesPath)
+    {
+        // Lines written by others come first
+        if(tailing())
+            readTail();
+        if(m_linesCount >= 0 && QFile::exists(fileName))
+            return appendLines(fileName);
+    }
+    else
+    {
+        stopTail();
+    }
+
+    QSaveFile file(fileName);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        QMODELSLOG_WARNING()<<"cannot open file:"<<fileName;
+        return false;
+    }
+
+    // Written by chunks from a snapshot, without building the whole text
+    QJsonListWriter writer(&file, true);
+    if(!writer.writeLines(snapshot()))
+    {
+        QMODELSLOG_WARNING()<<"cannot write file:"<<file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+
+    const qint64 size = file.pos();
+    if(!file.commit())
+        return false;
+
+    m_linesPath = fileName;
+    m_linesCount = count();
+    m_linesOffset = size;
+
+    return true;
+}
+
+QByteArray QJsonListModel::toLines() const
+{
+    QByteArray ret;
+    QBuffer buffer(&ret);
+    buffer.open(QIODevice::WriteOnly);
+
+    QJsonListWriter writer(&buffer, true);
+    writer.writeLines(snapshot());
+
+    return ret;
+}
+
+bool QJsonListModel::tailPath(const QString& fileName)
+{
+    stopTail();
+    if(!loadLinesFile(fileName, true))
         return false;
+
+    m_tailWatcher = new QFileSystemWatcher(QStringList{fileName}, this);
+    connect(m_tailWatcher, &QFileSystemWatcher::fileChanged, this, &QJsonListModel::readTail);
+    emit this->tailingChanged(true);
+
+    return true;
+}
+
+void QJsonListModel::stopTail()
+{
+    if(!m_tailWatcher)
+        return;
+
+    delete m_tailWatcher;
+    m_tailWatcher = nullptr;
+    emit this->tailingChanged(false);
+}
+
+bool QJsonListModel::tailing() const
+{
+    return m_tailWatcher != nullptr;
+}
+
+bool QJsonListModel::loadLinesFile(const QString& fileName, bool completeLines)
+{
+    QJsonLinesReader reader;
+    reader.setProjection(projection());
+    reader.setInternStrings(internStrings());
+    QVariantList storage;
+    qint64 size;
+    bool ok;
+
+    if(completeLines)
+    {
+        // A tailed file is being written and may be truncated at any time, it is read by blocks and not mapped.
+        // Its last line may be incomplete, it is read once its line break is written
+        QFile file(fileName);
+
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            QMODELSLOG_WARNING()<<"Error opening file:"<<file.errorString();
+            return false;
+        }
+
+        ok = readCompleteLines(file, reader, storage, size);
+    }
+    else
+    {
+        QMappedFile file(fileName);
+
+        if (!file.isOpen())
+        {
+            QMODELSLOG_WARNING()<<"Error opening file:"<<file.errorString();
+            return false;
+        }
+
+        size = file.size();
+        ok = reader.read(file.data(), file.data() + size, storage);
     }
 
-    if(!jdoc.isArray())
+    if(!ok)
     {
-        QMODELSLOG_WARNING()<<"cannot load non array json";
+        QMODELSLOG_WARNING()<<"Error loading json lines:"<<reader.errorString();
         return false;
     }
 
-    return setStorage(jdoc.array().toVariantList());
+    if(!setStorage(storage))
+        return false;
+
+    m_linesPath = fileName;
+    m_linesCount = count();
+    m_linesOffset = size;
+
+    return true;
 }
 
-bool QJsonListModel::syncPath(const QString& fileName) const
+bool QJsonListModel::appendLines(const QString& fileName)
 {
     QFile file(fileName);
 
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    if (!file.open(QIODevice::ReadWrite))
     {
         QMODELSLOG_WARNING()<<"cannot open file:"<<fileName;
         return false;
     }
 
-    bool ret = file.write(toJson());
+    const qint64 size = file.size();
+    const bool lineBreak = size > 0 && file.seek(size - 1) && file.read(1) != "\n";
+
+    QJsonListWriter writer(&file, true);
+    if(!file.seek(size) || (lineBreak && file.write("\n") != 1) || !writer.writeLines(snapshot(), m_linesCount))
+    {
+        QMODELSLOG_WARNING()<<"cannot write file:"<<file.errorString();
+        return false;
+    }
+
+    m_linesCount = count();
+    m_linesOffset = file.pos();
+
+    return true;
+}
+
+void QJsonListModel::readTail()
+{
+    // Editors and log rotation replace the file, the watcher has to follow the new one
+    if(!m_tailWatcher->files().contains(m_linesPath) && QFile::exists(m_linesPath))
+        m_tailWatcher->addPath(m_linesPath);
+
+    QFile file(m_linesPath);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    // Truncated or rotated, read again from the start
+    if(file.size() < m_linesOffset)
+    {
+        loadLinesFile(m_linesPath, true);
+        return;
+    }
+
+    if(file.size() == m_linesOffset || !file.seek(m_linesOffset))
+        return;
+
+    QJsonLinesReader reader;
+    reader.setProjection(projection());
+    reader.setInternStrings(internStrings());
+    QVariantList items;
+    qint64 size;
+    const bool ok = readCompleteLines(file, reader, items, size);
+    m_linesOffset += size;
+    if(!ok)
+    {
+        // The model misses these lines now, the next sync rewrites the file
+        QMODELSLOG_WARNING()<<"Error loading json lines:"<<reader.errorString();
+        m_linesCount = -1;
+        return;
+    }
+
+    if(items.isEmpty())
+        return;
+
+    const bool synced = m_linesCount == count();
+    insert(count(), QVariant(items));
+    m_linesCount = synced ? count() : -1;
+}
+
+void QJsonListModel::onStorageUpdated(QVariantListModel::StorageChange change, int first)
+{
+    // Rows appended after the lines of the file can be appended to it, any other change rewrites it
+    if(m_linesCount >= 0 && (change != InsertChange || first < m_linesCount))
+        m_linesCount = -1;
+}
+
+bool QJsonListModel::loadPathCbor(const QString& fileName)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        QMODELSLOG_WARNING()<<"Error opening file:"<<file.errorString();
+        return false;
+    }
+
+    bool ret = loadCborDevice(&file);
     file.close();
 
     return ret;
 }
 
-QByteArray QJsonListModel::toJson(QJsonListModel::JsonFormat format) const
+bool QJsonListModel::loadCbor(const QByteArray& cbor)
+{
+    QBuffer buffer;
+    buffer.setData(cbor);
+    buffer.open(QIODevice::ReadOnly);
+
+    return loadCborDevice(&buffer);
+}
+
+bool QJsonListModel::loadCborDevice(QIODevice* device)
 {
-    return QJsonDocument(QJsonArray::fromVariantList(storage())).toJson(QJsonDocument::JsonFormat(format));
+    QCborArrayReader reader(device);
+    reader.setProjection(projection());
+    QVector<Row> rows;
+    bool columnar=false;
+    QVariantList storage;
+
+    // Matching the rows by key needs the items
+    if(!keyField().isEmpty())
+    {
+        QVariant item;
+        while(reader.readNext(item))
+            storage.append(item);
+    }
+    else
+    {
+        readRows([&reader](Row& row, QVariant& item, bool& isObject) { return reader.readNextRow(row, item, isObject); },
+                 reader.fields(), rows, columnar);
+    }
+
+    if(reader.hasError())
+    {
+        QMODELSLOG_WARNING()<<"Error loading cbor:"<<reader.errorString();
+        return false;
+    }
+
+    if(!keyField().isEmpty())
+        return setStorage(storage);
+
+    return resetRows(columnar ? reader.fields() : QStringList(), columnar, rows);
+}
+
+bool QJsonListModel::syncPathCbor(const QString& fileName) const
+{
+    QSaveFile file(fileName);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        QMODELSLOG_WARNING()<<"cannot open file:"<<fileName;
+        return false;
+    }
+
+    // Written straight to the file, the whole document is never held in memory
+    QCborStreamWriter writer(&file);
+    writeCbor(writer, snapshot());
+
+    return file.commit();
+}
+
+QByteArray QJsonListModel::toCbor() const
+{
+    QByteArray ret;
+    QCborStreamWriter writer(&ret);
+    writeCbor(writer, snapshot());
+    return ret;
+}
+
+QStringList QJsonListModel::projection() const
+{
+    return hasDeclaredFields() ? fields() : QStringList();
+}
+
+void QJsonListModel::readRows(const RowReader& readNext, const QStringList& fields, QVector<Row>& rows, bool& columnar) const
+{
+    // Objects are read straight into rows, the first element decides whether the model has fields
+    columnar = isColumnar();
+    bool schemaKnown = !roleNames().isEmpty();
+    Row row;
+    QVariant item;
+    bool isObject;
+    while(readNext(row, item, isObject))
+    {
+        if(!schemaKnown)
+        {
+            columnar = isObject;
+            schemaKnown = true;
+        }
+
+        if(columnar && !isObject)
+        {
+            QMODELSLOG_WARNING() << "cannot store a non map item in a model with fields:" << item;
+            row.clear();
+        }
+        else if(!columnar)
+        {
+            if(isObject)
+                item = toMap(fields, row);
+            row = Row{item};
+        }
+
+        rows.append(row);
+    }
+}
+
+void QJsonListModel::writeCbor(QCborStreamWriter& writer, const QVariantListSnapshot& snapshot)
+{
+    const QVariantListRows& rows = snapshot.rows();
+    const QStringList& fields = snapshot.fields();
+
+    writer.startArray(quint64(rows.count()));
+    for(int i = 0; i < rows.count(); ++i)
+    {
+        const Row& row = rows.at(i);
+        if(!snapshot.isColumnar())
+        {
+            writeCbor(writer, row.value(0));
+            continue;
+        }
+
+        // Only the fields set in the row, like the map of the item
+        quint64 size = 0;
+        for(const QVariant& value: row)
+            size += value.isValid() ? 1 : 0;
+
+        writer.startMap(size);
+        for(int column = 0; column < row.count(); ++column)
+        {
+            const QVariant& value = row.at(column);
+            if(!value.isValid())
+                continue;
+            writer.append(fields.at(column));
+            writeCbor(writer, value);
+        }
+        writer.endMap();
+    }
+    writer.endArray();
+}
+
+void QJsonListModel::writeCbor(QCborStreamWriter& writer, const QVariant& value)
+{
+    switch(value.userType())
+    {
+    case QMetaType::UnknownType:
+    case QMetaType::Nullptr:
+        writer.appendNull();
+        break;
+    case QMetaType::Bool:
+        writer.append(value.toBool());
+        break;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+        writer.append(value.toLongLong());
+        break;
+    case QMetaType::ULongLong:
+        writer.append(value.toULongLong());
+        break;
+    case QMetaType::Double:
+        writer.append(value.toDouble());
+        break;
+    case QMetaType::QString:
+        writer.append(*static_cast<const QString*>(value.constData()));
+        break;
+    case QMetaType::QByteArray:
+        writer.append(*static_cast<const QByteArray*>(value.constData()));
+        break;
+    case QMetaType::QVariantMap:
+    {
+        const QVariantMap& map = *static_cast<const QVariantMap*>(value.constData());
+        writer.startMap(quint64(map.size()));
+        for(QVariantMap::const_iterator it = map.cbegin(); it != map.cend(); ++it)
+        {
+            writer.append(it.key());
+            writeCbor(writer, it.value());
+        }
+        writer.endMap();
+        break;
+    }
+    case QMetaType::QVariantList:
+    {
+        const QVariantList& list = *static_cast<const QVariantList*>(value.constData());
+        writer.startArray(quint64(list.size()));
+        for(const QVariant& item: list)
+            writeCbor(writer, item);
+        writer.endArray();
+        break;
+    }
+    default:
+        QCborValue::fromVariant(value).toCbor(writer);
+        break;
+    }
 }
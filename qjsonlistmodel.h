@@ -1,18 +1,24 @@
 #ifndef QJSONLISTMODEL_H
 #define QJSONLISTMODEL_H
 
-#include "qvariantlistmodel.h"
+#include "qvariantlistfilemodel.h"
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonValue>
 #include <QFile>
 
-class QJsonListModel: public QVariantListModel
+class QCborStreamWriter;
+class QJsonArrayReader;
+class QFileSystemWatcher;
+
+class QJsonListModel: public QVariantListFileModel
 {
     Q_OBJECT
     QML_NAMED_ELEMENT(JsonListModel)
 
+    Q_PROPERTY(bool tailing READ tailing NOTIFY tailingChanged)
+
 public:
     explicit QJsonListModel(QObject * parent = nullptr);
 
@@ -22,12 +28,72 @@ public:
     };
     Q_ENUM (JsonFormat)
 
-    Q_INVOKABLE bool syncPath(const QString& path) const;
+    Q_INVOKABLE bool syncPath(const QString& path, QJsonListModel::JsonFormat format = Indented) const;
+    // Writes a snapshot of the rows on the global thread pool, then emits pathSynced()
+    Q_INVOKABLE bool syncPathAsync(const QString& path, QJsonListModel::JsonFormat format = Indented);
     Q_INVOKABLE QByteArray toJson(QJsonListModel::JsonFormat format = Indented) const;
 
+    // Reads a top level array from the device, element by element
+    bool loadDevice(QIODevice* device);
+
+    // JSON Lines, one value per line. When the file was last loaded or synced by the model
+    // and rows were only appended since, syncLinesPath() appends them instead of rewriting it
+    Q_INVOKABLE bool syncLinesPath(const QString& path);
+    Q_INVOKABLE QByteArray toLines() const;
+
+    // CBOR, streamed between the device and the rows without building QCborValue trees
+    Q_INVOKABLE bool syncPathCbor(const QString& path) const;
+    Q_INVOKABLE QByteArray toCbor() const;
+    bool loadCborDevice(QIODevice* device);
+
+    // Loads the file then appends to the model the lines written to it, until stopTail()
+    Q_INVOKABLE bool tailPath(const QString& path);
+    Q_INVOKABLE void stopTail();
+    bool tailing() const;
+
 public slots:
     bool loadPath(const QString& path);
+    bool loadPathAsync(const QString& path);
     bool loadJson(const QByteArray& json);
+    bool loadLinesPath(const QString& path);
+    bool loadLines(const QByteArray& lines);
+    bool loadPathCbor(const QString& path);
+    bool loadCbor(const QByteArray& cbor);
+
+signals:
+    void tailingChanged(bool tailing);
+    void pathSynced(const QString& path, bool ok);
+
+protected:
+    static bool readJson(QJsonArrayReader& reader, const QVariantListLoader::Sink& sink);
+    // Appends the object elements to the loader as rows, or every element as an item when the first isn't an object
+    static bool readJsonRows(QJsonArrayReader& reader, QVariantListLoader* loader, qint64 total);
+    // Fields the loaders keep, empty to keep them all
+    QStringList projection() const;
+
+private:
+    bool loadArray(QJsonArrayReader& reader);
+    // Parses the file on the thread pool, for loadPathAsync() and the reloads of watch
+    std::function<bool(QVariantListLoader* loader)> pathParser(const QString& path) const;
+
+    using RowReader = std::function<bool(Row& row, QVariant& item, bool& isObject)>;
+    // Reads every element into the rows to load, fields being the fields of the object elements
+    void readRows(const RowReader& readNext, const QStringList& fields, QVector<Row>& rows, bool& columnar) const;
+    static bool writeJson(const QString& path, const QVariantListSnapshot& snapshot, QJsonListModel::JsonFormat format);
+    static void writeCbor(QCborStreamWriter& writer, const QVariantListSnapshot& snapshot);
+    static void writeCbor(QCborStreamWriter& writer, const QVariant& value);
+
+    bool loadLinesFile(const QString& path, bool completeLines);
+    bool appendLines(const QString& path);
+    void readTail();
+    void onStorageUpdated(QVariantListModel::StorageChange change, int first);
+
+    // The first m_linesCount rows are the lines of m_linesPath, -1 when the file has to be rewritten.
+    // m_linesOffset bytes of the file were read or written
+    QString m_linesPath;
+    int m_linesCount=-1;
+    qint64 m_linesOffset=0;
+    QFileSystemWatcher* m_tailWatcher=nullptr;
 };
 
 Q_DECLARE_METATYPE (QJsonListModel::JsonFormat)
@@ -0,0 +1,239 @@
+#include "qjsonlistwriter.h"
+
+#include <QJsonValue>
+#include <QLocale>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+QJsonListWriter::QJsonListWriter(QIODevice* device, bool compact) :
+    m_device(device),
+    m_compact(compact)
+{
+
+}
+
+bool QJsonListWriter::write(const QVariantListSnapshot& snapshot)
+{
+    const QVariantListRows& rows = snapshot.rows();
+    const QStringList& fields = snapshot.fields();
+    const QVector<int> columns = sortedColumns(fields);
+
+    m_buffer.reserve(ChunkSize + ChunkSize / 4);
+    m_buffer += m_compact ? "[" : "[\n";
+    for(int i = 0; i < rows.count(); ++i)
+    {
+        if(i > 0)
+            m_buffer += m_compact ? "," : ",\n";
+        writeIndent(1);
+        if(snapshot.isColumnar())
+            writeRow(rows.at(i), fields, columns);
+        else
+            writeValue(rows.at(i).value(0), 1);
+
+        if(!flush(ChunkSize))
+            return false;
+    }
+    if(!rows.isEmpty() && !m_compact)
+        m_buffer += '\n';
+    m_buffer += m_compact ? "]" : "]\n";
+
+    return flush(0);
+}
+
+bool QJsonListWriter::writeLines(const QVariantListSnapshot& snapshot, int first)
+{
+    const QVariantListRows& rows = snapshot.rows();
+    const QStringList& fields = snapshot.fields();
+    const QVector<int> columns = sortedColumns(fields);
+
+    // Lines are always compact, a line break in a value would split it
+    const bool compact = m_compact;
+    m_compact = true;
+    m_buffer.reserve(ChunkSize + ChunkSize / 4);
+    for(int i = qMax(first, 0); i < rows.count(); ++i)
+    {
+        if(snapshot.isColumnar())
+            writeRow(rows.at(i), fields, columns);
+        else
+            writeValue(rows.at(i).value(0), 0);
+        m_buffer += '\n';
+
+        if(!flush(ChunkSize))
+            break;
+    }
+    m_compact = compact;
+
+    return flush(0);
+}
+
+QVector<int> QJsonListWriter::sortedColumns(const QStringList& fields)
+{
+    // Objects list their keys sorted, like QJsonObject
+    QVector<int> ret(fields.count());
+    std::iota(ret.begin(), ret.end(), 0);
+    std::sort(ret.begin(), ret.end(), [&fields](int a, int b) { return fields.at(a) < fields.at(b); });
+    return ret;
+}
+
+void QJsonListWriter::writeRow(const QVariantListRows::Row& row, const QStringList& fields, const QVector<int>& columns)
+{
+    m_buffer += m_compact ? "{" : "{\n";
+    bool first = true;
+    for(int column: columns)
+    {
+        const QVariant& value = row.value(column);
+        if(!value.isValid())
+            continue;
+
+        if(!first)
+            m_buffer += m_compact ? "," : ",\n";
+        first = false;
+        writeIndent(2);
+        writeString(fields.at(column));
+        m_buffer += m_compact ? ":" : ": ";
+        writeValue(value, 2);
+    }
+    if(!first && !m_compact)
+        m_buffer += '\n';
+    writeIndent(1);
+    m_buffer += '}';
+}
+
+void QJsonListWriter::writeValue(const QVariant& value, int depth)
+{
+    switch(value.userType())
+    {
+    case QMetaType::UnknownType:
+    case QMetaType::Nullptr:
+        m_buffer += "null";
+        break;
+    case QMetaType::Bool:
+        m_buffer += value.toBool() ? "true" : "false";
+        break;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+        m_buffer += QByteArray::number(value.toLongLong());
+        break;
+    case QMetaType::ULongLong:
+        if(value.toULongLong() <= quint64(std::numeric_limits<qint64>::max()))
+            m_buffer += QByteArray::number(value.toLongLong());
+        else
+            writeNumber(value.toDouble());
+        break;
+    case QMetaType::Float:
+    case QMetaType::Double:
+        writeNumber(value.toDouble());
+        break;
+    case QMetaType::QString:
+        writeString(*static_cast<const QString*>(value.constData()));
+        break;
+    case QMetaType::QVariantMap:
+    {
+        const QVariantMap& map = *static_cast<const QVariantMap*>(value.constData());
+        m_buffer += m_compact ? "{" : "{\n";
+        for(QVariantMap::const_iterator it = map.cbegin(); it != map.cend(); ++it)
+        {
+            if(it != map.cbegin())
+                m_buffer += m_compact ? "," : ",\n";
+            writeIndent(depth + 1);
+            writeString(it.key());
+            m_buffer += m_compact ? ":" : ": ";
+            writeValue(it.value(), depth + 1);
+        }
+        if(!map.isEmpty() && !m_compact)
+            m_buffer += '\n';
+        writeIndent(depth);
+        m_buffer += '}';
+        break;
+    }
+    case QMetaType::QVariantList:
+    {
+        const QVariantList& list = *static_cast<const QVariantList*>(value.constData());
+        m_buffer += m_compact ? "[" : "[\n";
+        for(int i = 0; i < list.count(); ++i)
+        {
+            if(i > 0)
+                m_buffer += m_compact ? "," : ",\n";
+            writeIndent(depth + 1);
+            writeValue(list.at(i), depth + 1);
+        }
+        if(!list.isEmpty() && !m_compact)
+            m_buffer += '\n';
+        writeIndent(depth);
+        m_buffer += ']';
+        break;
+    }
+    default:
+    {
+        // Dates, string lists and the other types convert the way QJsonValue converts them
+        const QVariant converted = QJsonValue::fromVariant(value).toVariant();
+        if(converted.userType() == value.userType())
+            m_buffer += "null";
+        else
+            writeValue(converted, depth);
+        break;
+    }
+    }
+}
+
+void QJsonListWriter::writeString(const QString& string)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    const QByteArray utf8 = string.toUtf8();
+    m_buffer += '"';
+    for(const char c: utf8)
+    {
+        switch(c)
+        {
+        case '"': m_buffer += "\\\""; break;
+        case '\\': m_buffer += "\\\\"; break;
+        case '\b': m_buffer += "\\b"; break;
+        case '\f': m_buffer += "\\f"; break;
+        case '\n': m_buffer += "\\n"; break;
+        case '\r': m_buffer += "\\r"; break;
+        case '\t': m_buffer += "\\t"; break;
+        default:
+            if(uchar(c) < 0x20)
+            {
+                m_buffer += "\\u00";
+                m_buffer += hex[uchar(c) >> 4];
+                m_buffer += hex[uchar(c) & 0xF];
+            }
+            else
+            {
+                m_buffer += c;
+            }
+            break;
+        }
+    }
+    m_buffer += '"';
+}
+
+void QJsonListWriter::writeNumber(double number)
+{
+    if(qIsFinite(number))
+        m_buffer += QByteArray::number(number, 'g', QLocale::FloatingPointShortest);
+    else
+        m_buffer += "null";
+}
+
+void QJsonListWriter::writeIndent(int depth)
+{
+    if(!m_compact)
+        m_buffer.append(4 * depth, ' ');
+}
+
+bool QJsonListWriter::flush(int threshold)
+{
+    if(m_buffer.size() < threshold)
+        return m_ok;
+
+    // The reserved capacity is kept for the next chunk
+    m_ok = m_ok && m_device->write(m_buffer) == m_buffer.size();
+    m_buffer.resize(0);
+    return m_ok;
+}
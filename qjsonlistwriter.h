@@ -0,0 +1,39 @@
+#ifndef QJSONLISTWRITER_H
+#define QJSONLISTWRITER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QVariant>
+
+#include "qvariantlistsnapshot.h"
+
+// Writes the rows of a snapshot to a device as a top level JSON array or as JSON Lines, by chunks of ChunkSize bytes,
+// without building a QJsonDocument. The text is the one QJsonDocument::toJson() would produce.
+// Only reads the snapshot, so it can run on any thread.
+class QJsonListWriter
+{
+public:
+    QJsonListWriter(QIODevice* device, bool compact);
+
+    bool write(const QVariantListSnapshot& snapshot);
+    // Writes the rows from first as JSON Lines, one compact value per line
+    bool writeLines(const QVariantListSnapshot& snapshot, int first = 0);
+
+    static const int ChunkSize = 1 << 16;
+
+private:
+    static QVector<int> sortedColumns(const QStringList& fields);
+    void writeRow(const QVariantListRows::Row& row, const QStringList& fields, const QVector<int>& columns);
+    void writeValue(const QVariant& value, int depth);
+    void writeString(const QString& string);
+    void writeNumber(double number);
+    void writeIndent(int depth);
+    bool flush(int threshold);
+
+    QIODevice* m_device;
+    bool m_compact;
+    QByteArray m_buffer;
+    bool m_ok=true;
+};
+
+#endif // QJSONLISTWRITER_H
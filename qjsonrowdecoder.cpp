@@ -0,0 +1,498 @@
+#include "qjsonrowdecoder.h"
+
+#include <cstring>
+
+void QJsonRowDecoder::setProjection(const QStringList& fields)
+{
+    m_fields.clear();
+    m_fieldIndexes.clear();
+    m_projected = !fields.isEmpty();
+    for(const QString& field: fields)
+    {
+        if(m_fieldIndexes.contains(field.toUtf8()))
+            continue;
+        m_fieldIndexes.insert(field.toUtf8(), m_fields.count());
+        m_fields.append(field);
+    }
+}
+
+bool QJsonRowDecoder::decode(const char* begin, const char* end, QVariant& value)
+{
+    m_pos = begin;
+    m_end = end;
+    m_error.clear();
+
+    if(!skipWhitespace())
+        return setError(QStringLiteral("unexpected end of json"));
+    if(!parseValue(value, 0))
+        return false;
+    if(skipWhitespace())
+        return setError(QStringLiteral("garbage after json value"));
+
+    return true;
+}
+
+bool QJsonRowDecoder::decodeRow(const char* begin, const char* end, Row& row)
+{
+    m_pos = begin;
+    m_end = end;
+    m_error.clear();
+
+    if(!skipWhitespace() || *m_pos != '{')
+        return false;
+    ++m_pos;
+
+    row.clear();
+    row.resize(m_fields.count());
+
+    if(!skipWhitespace())
+        return setError(QStringLiteral("unterminated object"));
+
+    if(*m_pos == '}')
+        ++m_pos;
+    else if(!parseRowMembers(row))
+        return false;
+
+    if(skipWhitespace())
+        return setError(QStringLiteral("garbage after json value"));
+
+    return true;
+}
+
+bool QJsonRowDecoder::parseRowMembers(Row& row)
+{
+    forever
+    {
+        const char* keyBegin;
+        const char* keyEnd;
+        bool escaped;
+        if(*m_pos != '"')
+            return setError(QStringLiteral("missing key in object"));
+        if(!scanString(keyBegin, keyEnd, escaped))
+            return false;
+
+        if(!skipWhitespace() || *m_pos != ':')
+            return setError(QStringLiteral("missing colon in object"));
+        ++m_pos;
+        if(!skipWhitespace())
+            return setError(QStringLiteral("unterminated object"));
+
+        int column;
+        if(!fieldColumn(keyBegin, keyEnd, escaped, column))
+            return false;
+
+        if(column < 0)
+        {
+            if(!skipValue())
+                return false;
+        }
+        else
+        {
+            if(row.count() < m_fields.count())
+                row.resize(m_fields.count());
+            if(!parseValue(row[column], 1))
+                return false;
+        }
+
+        if(!skipWhitespace())
+            return setError(QStringLiteral("unterminated object"));
+        if(*m_pos == '}')
+        {
+            ++m_pos;
+            return true;
+        }
+        if(*m_pos != ',')
+            return setError(QStringLiteral("missing comma in object"));
+        ++m_pos;
+        if(!skipWhitespace())
+            return setError(QStringLiteral("unterminated object"));
+    }
+}
+
+bool QJsonRowDecoder::fieldColumn(const char* begin, const char* end, bool escaped, int& column)
+{
+    // The column is found from the raw bytes of the key, a key is only decoded the first time it is seen
+    QString decodedKey;
+    if(escaped && !unescape(begin, end, decodedKey))
+        return false;
+    const QByteArray utf8Key = escaped ? decodedKey.toUtf8() : QByteArray::fromRawData(begin, int(end - begin));
+
+    column = m_fieldIndexes.value(utf8Key, -1);
+    if(column >= 0 || m_projected)
+        return true;
+
+    column = m_fields.count();
+    m_fields.append(escaped ? decodedKey : QString::fromUtf8(begin, int(end - begin)));
+    m_fieldIndexes.insert(QByteArray(utf8Key.constData(), utf8Key.size()), column);
+    return true;
+}
+
+bool QJsonRowDecoder::parseValue(QVariant& value, int depth)
+{
+    if(depth > MaxDepth)
+        return setError(QStringLiteral("json is too deeply nested"));
+
+    switch(*m_pos)
+    {
+    case '{':
+    {
+        QVariantMap map;
+        if(!parseObject(map, depth + 1))
+            return false;
+        value = map;
+        return true;
+    }
+    case '[':
+    {
+        QVariantList list;
+        if(!parseArray(list, depth + 1))
+            return false;
+        value = list;
+        return true;
+    }
+    case '"':
+    {
+        QString string;
+        if(!parseString(string))
+            return false;
+        value = string;
+        return true;
+    }
+    case 't':
+        return parseLiteral("true", QVariant(true), value);
+    case 'f':
+        return parseLiteral("false", QVariant(false), value);
+    case 'n':
+        return parseLiteral("null", QVariant::fromValue(nullptr), value);
+    default:
+        return parseNumber(value);
+    }
+}
+
+bool QJsonRowDecoder::parseObject(QVariantMap& map, int depth)
+{
+    ++m_pos;
+    if(!skipWhitespace())
+        return setError(QStringLiteral("unterminated object"));
+
+    if(*m_pos == '}')
+    {
+        ++m_pos;
+        return true;
+    }
+
+    forever
+    {
+        const char* keyBegin;
+        const char* keyEnd;
+        bool escaped;
+        if(*m_pos != '"')
+            return setError(QStringLiteral("missing key in object"));
+        if(!scanString(keyBegin, keyEnd, escaped))
+            return false;
+
+        if(!skipWhitespace() || *m_pos != ':')
+            return setError(QStringLiteral("missing colon in object"));
+        ++m_pos;
+        if(!skipWhitespace())
+            return setError(QStringLiteral("unterminated object"));
+
+        // The projection only applies to the members of the top level object
+        int column = 0;
+        if(m_projected && depth == 1 && !fieldColumn(keyBegin, keyEnd, escaped, column))
+            return false;
+
+        if(column < 0)
+        {
+            if(!skipValue())
+                return false;
+        }
+        else
+        {
+            QString key;
+            if(!parseKey(keyBegin, keyEnd, escaped, key) || !parseValue(map[key], depth))
+                return false;
+        }
+
+        if(!skipWhitespace())
+            return setError(QStringLiteral("unterminated object"));
+        if(*m_pos == '}')
+        {
+            ++m_pos;
+            return true;
+        }
+        if(*m_pos != ',')
+            return setError(QStringLiteral("missing comma in object"));
+        ++m_pos;
+        if(!skipWhitespace())
+            return setError(QStringLiteral("unterminated object"));
+    }
+}
+
+bool QJsonRowDecoder::parseArray(QVariantList& list, int depth)
+{
+    ++m_pos;
+    if(!skipWhitespace())
+        return setError(QStringLiteral("unterminated array"));
+
+    if(*m_pos == ']')
+    {
+        ++m_pos;
+        return true;
+    }
+
+    forever
+    {
+        list.append(QVariant());
+        if(!parseValue(list.last(), depth))
+            return false;
+
+        if(!skipWhitespace())
+            return setError(QStringLiteral("unterminated array"));
+        if(*m_pos == ']')
+        {
+            ++m_pos;
+            return true;
+        }
+        if(*m_pos != ',')
+            return setError(QStringLiteral("missing comma in array"));
+        ++m_pos;
+        if(!skipWhitespace())
+            return setError(QStringLiteral("unterminated array"));
+    }
+}
+
+bool QJsonRowDecoder::parseNumber(QVariant& value)
+{
+    const char* begin = m_pos;
+    if(*m_pos == '-')
+        ++m_pos;
+
+    // Integers short enough to be exact in a double skip the generic conversion
+    qint64 integer = 0;
+    int digits = 0;
+    while(m_pos < m_end && *m_pos >= '0' && *m_pos <= '9')
+    {
+        // Longer integers go through the generic conversion, only their digits are counted
+        if(++digits <= 15)
+            integer = integer * 10 + (*m_pos - '0');
+        ++m_pos;
+    }
+
+    if(digits == 0)
+        return setError(QStringLiteral("illegal value"));
+
+    bool isInteger = true;
+    while(m_pos < m_end && ((*m_pos >= '0' && *m_pos <= '9') || *m_pos == '.' || *m_pos == 'e' || *m_pos == 'E' || *m_pos == '+' || *m_pos == '-'))
+    {
+        isInteger = false;
+        ++m_pos;
+    }
+
+    if(isInteger && digits <= 15)
+    {
+        value = double(*begin == '-' ? -integer : integer);
+        return true;
+    }
+
+    bool ok=false;
+    const double number = QByteArray::fromRawData(begin, int(m_pos - begin)).toDouble(&ok);
+    if(!ok)
+        return setError(QStringLiteral("illegal number"));
+
+    value = number;
+    return true;
+}
+
+bool QJsonRowDecoder::parseLiteral(const char* literal, const QVariant& value, QVariant& ret)
+{
+    const int size = int(std::strlen(literal));
+    if(m_end - m_pos < size || std::strncmp(m_pos, literal, size_t(size)) != 0)
+        return setError(QStringLiteral("illegal value"));
+
+    m_pos += size;
+    ret = value;
+    return true;
+}
+
+bool QJsonRowDecoder::skipValue()
+{
+    switch(*m_pos)
+    {
+    case '"':
+    {
+        const char* begin;
+        const char* end;
+        bool escaped;
+        return scanString(begin, end, escaped);
+    }
+    case '{':
+    case '[':
+    {
+        int nesting = 0;
+        while(m_pos < m_end)
+        {
+            const char c = *m_pos;
+            if(c == '"')
+            {
+                const char* begin;
+                const char* end;
+                bool escaped;
+                if(!scanString(begin, end, escaped))
+                    return false;
+                continue;
+            }
+
+            ++m_pos;
+            if(c == '{' || c == '[')
+                ++nesting;
+            else if((c == '}' || c == ']') && --nesting == 0)
+                return true;
+        }
+        return setError(QStringLiteral("unterminated value"));
+    }
+    case 't':
+    case 'f':
+    case 'n':
+    {
+        QVariant ignored;
+        return parseLiteral(*m_pos == 't' ? "true" : *m_pos == 'f' ? "false" : "null", QVariant(), ignored);
+    }
+    default:
+    {
+        const char* begin = m_pos;
+        while(m_pos < m_end && ((*m_pos >= '0' && *m_pos <= '9') || *m_pos == '.' || *m_pos == 'e' || *m_pos == 'E' || *m_pos == '+' || *m_pos == '-'))
+            ++m_pos;
+        return m_pos > begin || setError(QStringLiteral("illegal value"));
+    }
+    }
+}
+
+bool QJsonRowDecoder::scanString(const char*& begin, const char*& end, bool& escaped)
+{
+    ++m_pos;
+    begin = m_pos;
+    escaped = false;
+    while(m_pos < m_end)
+    {
+        const char c = *m_pos;
+        if(c == '"')
+        {
+            end = m_pos;
+            ++m_pos;
+            return true;
+        }
+
+        if(c == '\\')
+        {
+            escaped = true;
+            ++m_pos;
+            if(m_pos < m_end)
+                ++m_pos;
+            continue;
+        }
+
+        if(uchar(c) < 0x20)
+            return setError(QStringLiteral("illegal character in string"));
+        ++m_pos;
+    }
+
+    return setError(QStringLiteral("unterminated string"));
+}
+
+bool QJsonRowDecoder::parseString(QString& string)
+{
+    const char* begin;
+    const char* end;
+    bool escaped;
+    if(!scanString(begin, end, escaped))
+        return false;
+
+    if(escaped)
+        return unescape(begin, end, string);
+
+    string = (m_internStrings && end - begin <= MaxCachedLength) ? cached(m_strings, begin, end)
+                                                                 : QString::fromUtf8(begin, int(end - begin));
+    return true;
+}
+
+bool QJsonRowDecoder::parseKey(const char* begin, const char* end, bool escaped, QString& key)
+{
+    if(escaped)
+        return unescape(begin, end, key);
+
+    key = cached(m_keys, begin, end);
+    return true;
+}
+
+bool QJsonRowDecoder::unescape(const char* begin, const char* end, QString& string)
+{
+    string.clear();
+    string.reserve(int(end - begin));
+
+    const char* segment = begin;
+    for(const char* it = begin; it < end; ++it)
+    {
+        if(*it != '\\')
+            continue;
+
+        string += QString::fromUtf8(segment, int(it - segment));
+        ++it;
+        switch(*it)
+        {
+        case '"': string += QLatin1Char('"'); break;
+        case '\\': string += QLatin1Char('\\'); break;
+        case '/': string += QLatin1Char('/'); break;
+        case 'b': string += QLatin1Char('\b'); break;
+        case 'f': string += QLatin1Char('\f'); break;
+        case 'n': string += QLatin1Char('\n'); break;
+        case 'r': string += QLatin1Char('\r'); break;
+        case 't': string += QLatin1Char('\t'); break;
+        case 'u':
+        {
+            // Surrogate pairs come as two escapes, each one is a QChar
+            if(end - it < 5)
+                return setError(QStringLiteral("illegal escape sequence"));
+            bool ok=false;
+            const ushort unicode = QByteArray::fromRawData(it + 1, 4).toUShort(&ok, 16);
+            if(!ok)
+                return setError(QStringLiteral("illegal escape sequence"));
+            string += QChar(unicode);
+            it += 4;
+            break;
+        }
+        default:
+            return setError(QStringLiteral("illegal escape sequence"));
+        }
+        segment = it + 1;
+    }
+    string += QString::fromUtf8(segment, int(end - segment));
+
+    return true;
+}
+
+QString QJsonRowDecoder::cached(QHash<QByteArray, QString>& cache, const char* begin, const char* end)
+{
+    const int size = int(end - begin);
+    const QHash<QByteArray, QString>::const_iterator it = cache.constFind(QByteArray::fromRawData(begin, size));
+    if(it != cache.constEnd())
+        return it.value();
+
+    const QString ret = QString::fromUtf8(begin, size);
+    if(cache.size() < MaxCacheSize)
+        cache.insert(QByteArray(begin, size), ret);
+    return ret;
+}
+
+bool QJsonRowDecoder::skipWhitespace()
+{
+    while(m_pos < m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\n' || *m_pos == '\r'))
+        ++m_pos;
+    return m_pos < m_end;
+}
+
+bool QJsonRowDecoder::setError(const QString& error)
+{
+    m_error = error;
+    return false;
+}
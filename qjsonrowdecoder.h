@@ -0,0 +1,69 @@
+#ifndef QJSONROWDECODER_H
+#define QJSONROWDECODER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include <QVariant>
+
+#include "qvariantlistrows.h"
+
+// Decodes JSON text straight into variants, without building a QJsonDocument.
+// Objects can be decoded into rows holding one value per field, the fields being discovered on the way.
+// Keys and short strings are decoded from UTF-8 once and shared by every value repeating them.
+class QJsonRowDecoder
+{
+public:
+    using Row = QVariantListRows::Row;
+
+    // Only keeps these fields of the top level objects, the values of the other keys are skipped
+    // without being decoded. Clears the fields discovered so far
+    void setProjection(const QStringList& fields);
+    // When false, every string value gets its own copy, only the keys are shared
+    void setInternStrings(bool internStrings) { m_internStrings = internStrings; }
+
+    bool decode(const char* begin, const char* end, QVariant& value);
+    // Returns false with an empty error string when the text is valid but isn't an object
+    bool decodeRow(const char* begin, const char* end, Row& row);
+
+    const QStringList& fields() const { return m_fields; }
+    const QString& errorString() const { return m_error; }
+
+    static const int MaxDepth = 1024;
+    static const int MaxCachedLength = 64;
+    static const int MaxCacheSize = 1 << 16;
+
+private:
+    bool parseRowMembers(Row& row);
+    // Column of a key, discovering it unless there is a projection, -1 when it is projected out
+    bool fieldColumn(const char* begin, const char* end, bool escaped, int& column);
+    bool parseValue(QVariant& value, int depth);
+    bool parseObject(QVariantMap& map, int depth);
+    bool parseArray(QVariantList& list, int depth);
+    bool parseNumber(QVariant& value);
+    bool parseLiteral(const char* literal, const QVariant& value, QVariant& ret);
+    // Only checks the strings and the nesting of the value
+    bool skipValue();
+    // Reads a string token, begin and end delimit its raw content
+    bool scanString(const char*& begin, const char*& end, bool& escaped);
+    bool parseString(QString& string);
+    bool parseKey(const char* begin, const char* end, bool escaped, QString& key);
+    bool unescape(const char* begin, const char* end, QString& string);
+    QString cached(QHash<QByteArray, QString>& cache, const char* begin, const char* end);
+
+    bool skipWhitespace();
+    bool setError(const QString& error);
+
+    const char* m_pos=nullptr;
+    const char* m_end=nullptr;
+    QString m_error;
+
+    QStringList m_fields;
+    QHash<QByteArray, int> m_fieldIndexes;
+    bool m_projected=false;
+    bool m_internStrings=true;
+    QHash<QByteArray, QString> m_keys;
+    QHash<QByteArray, QString> m_strings;
+};
+
+#endif // QJSONROWDECODER_H
@@ -0,0 +1,21 @@
+#include "qmappedfile.h"
+
+QMappedFile::QMappedFile(const QString& path) :
+    m_file(path)
+{
+    m_open = m_file.open(QIODevice::ReadOnly);
+    if(!m_open)
+        return;
+
+    m_size = m_file.size();
+    if(m_size > 0)
+        m_map = m_file.map(0, m_size);
+    if(!m_map)
+        m_data = m_file.readAll();
+}
+
+QMappedFile::~QMappedFile()
+{
+    if(m_map)
+        m_file.unmap(m_map);
+}
@@ -0,0 +1,31 @@
+#ifndef QMAPPEDFILE_H
+#define QMAPPEDFILE_H
+
+#include <QByteArray>
+#include <QFile>
+
+// Read-only view of a whole file: a memory mapping when the file system allows it,
+// a copy of the file otherwise. The data stays valid as long as the view.
+class QMappedFile
+{
+public:
+    explicit QMappedFile(const QString& path);
+    ~QMappedFile();
+
+    bool isOpen() const { return m_open; }
+    QString errorString() const { return m_file.errorString(); }
+
+    const char* data() const { return m_map ? reinterpret_cast<const char*>(m_map) : m_data.constData(); }
+    qint64 size() const { return m_map ? m_size : m_data.size(); }
+
+private:
+    Q_DISABLE_COPY(QMappedFile)
+
+    QFile m_file;
+    bool m_open=false;
+    uchar* m_map=nullptr;
+    qint64 m_size=0;
+    QByteArray m_data;
+};
+
+#endif // QMAPPEDFILE_H
@@ -1,5 +1,6 @@
 #include "qmodelhelper.h"
 #include "qmodels_log.h"
+#include "qvariantlistmodel.h"
 
 #include <QSortFilterProxyModel>
 #include <QElapsedTimer>
@@ -525,6 +526,11 @@ int QModelHelper::indexOf(QAbstractItemModel* model, int role, const QVariant& v
     if(!model)
         return ret;
 
+    // Answered by a field index without walking the rows
+    const QVariantListModel* varModel = qobject_cast<const QVariantListModel*>(model);
+    if(varModel && varModel->isIndexed(role))
+        return varModel->indexOf(role, val);
+
     if(isSorted)
     {
         int lower = 0;
@@ -569,6 +575,10 @@ QList<int> QModelHelper::indexesOf(QAbstractItemModel* model, int role, const QV
     if(!model)
         return QList<int>();
 
+    const QVariantListModel* varModel = qobject_cast<const QVariantListModel*>(model);
+    if(varModel && varModel->isIndexed(role))
+        return varModel->indexesOf(role, val);
+
     QList<int> ret;
 
     for(int i=0; i<model->rowCount(); ++i)
@@ -3,6 +3,7 @@
 #include "qobjectlistmodel.h"
 #include "qobjectlistproperty.h"
 #include "qvariantlistmodel.h"
+#include "qvariantlistfilemodel.h"
 #include "qcheckableproxymodel.h"
 #include "qconcatenateproxymodel.h"
 #include "qemptymodel.h"
@@ -24,9 +25,12 @@ static void QModels_registerTypes()
 
     qmlRegisterType<QEmptyModel>("Eco.Tier1.Models", maj, min, "EmptyModel");
     qmlRegisterType<QVariantListModel>("Eco.Tier1.Models", maj, min, "VariantListModel");
+    qRegisterMetaType<QVariantListModel::StorageChange>("QVariantListModel::StorageChange");
+    qRegisterMetaType<QVariantListSnapshot>("QVariantListSnapshot");
     qmlRegisterType<QCheckableProxyModel>("Eco.Tier1.Models", maj, min, "CheckableProxyModel");
     qmlRegisterType<QConcatenateProxyModel>("Eco.Tier1.Models", maj, min, "ConcatenateProxyModel");
     qmlRegisterType<QModelMatcher>("Eco.Tier1.Models", maj, min, "ModelMatcher");
+    qmlRegisterUncreatableType<QVariantListFileModel>("Eco.Tier1.Models", maj, min, "VariantListFileModel", "VariantListFileModel is an abstract base class !");
     qmlRegisterType<QJsonTreeModel>("Eco.Tier1.Models", maj, min, "JsonTreeModel");
     qmlRegisterType<QJsonListModel>("Eco.Tier1.Models", maj, min, "JsonListModel");
     qRegisterMetaType<QJsonListModel::JsonFormat>("QJsonListModel::JsonFormat");
@@ -0,0 +1,401 @@
+#include "qvariantlistbinary.h"
+
+#include <QDataStream>
+#include <QtEndian>
+
+#include <cstring>
+#include <limits>
+
+namespace QVariantListBinaryFunctions
+{
+    template <typename T> inline
+    void append(QByteArray& out, T value)
+    {
+        char bytes[sizeof(T)];
+        qToLittleEndian(value, bytes);
+        out.append(bytes, int(sizeof(T)));
+    }
+
+    inline void appendDouble(QByteArray& out, double value)
+    {
+        quint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        append<quint64>(out, bits);
+    }
+
+    inline void appendString(QByteArray& out, const QString& value)
+    {
+        const QByteArray utf8 = value.toUtf8();
+        append<quint32>(out, quint32(utf8.size()));
+        out.append(utf8);
+    }
+
+    /// Bounds checked reads over the payload, every read fails once one did
+    class Reader
+    {
+    public:
+        Reader(const char* data, qint64 size) : m_data(data), m_end(data + size) {}
+
+        bool isValid() const { return m_valid; }
+        qint64 remaining() const { return m_valid ? m_end - m_data : 0; }
+
+        const char* take(qint64 size)
+        {
+            if(!m_valid || size < 0 || m_end - m_data < size)
+            {
+                m_valid = false;
+                return nullptr;
+            }
+            const char* ret = m_data;
+            m_data += size;
+            return ret;
+        }
+
+        template <typename T>
+        T read()
+        {
+            const char* bytes = take(qint64(sizeof(T)));
+            return bytes ? qFromLittleEndian<T>(bytes) : T();
+        }
+
+        double readDouble()
+        {
+            const quint64 bits = read<quint64>();
+            double ret;
+            std::memcpy(&ret, &bits, sizeof(ret));
+            return ret;
+        }
+
+        QString readString()
+        {
+            const quint32 size = read<quint32>();
+            const char* bytes = take(size);
+            return bytes ? QString::fromUtf8(bytes, int(size)) : QString();
+        }
+
+    private:
+        const char* m_data;
+        const char* m_end;
+        bool m_valid=true;
+    };
+}
+
+using namespace QVariantListBinaryFunctions;
+
+QByteArray QVariantListBinary::write(const QVariantListSnapshot& snapshot)
+{
+    const QVariantListRows& rows = snapshot.rows();
+    const bool columnar = snapshot.isColumnar();
+    const int columnCount = columnar ? snapshot.fields().count() : 1;
+
+    // First pass: the type of every column and the distinct strings
+    QVector<ColumnType> types;
+    QHash<QString, quint32> strings;
+    QStringList stringTable;
+    for(int column = 0; column < columnCount; ++column)
+    {
+        types.append(columnType(rows, column));
+        if(types.last() != StringColumn)
+            continue;
+
+        for(int row = 0; row < rows.count(); ++row)
+        {
+            const QVariant& value = rows.at(row).value(column);
+            if(!value.isValid())
+                continue;
+
+            const QString& string = *static_cast<const QString*>(value.constData());
+            if(!strings.contains(string))
+            {
+                strings.insert(string, quint32(stringTable.count()));
+                stringTable.append(string);
+            }
+        }
+    }
+
+    QByteArray ret;
+    append<quint32>(ret, Magic);
+    append<quint32>(ret, Version);
+    append<quint32>(ret, columnar ? 1 : 0);
+    append<quint32>(ret, quint32(rows.count()));
+    // CRC-32 and size of the payload, written once it is complete
+    append<quint32>(ret, 0);
+    append<quint64>(ret, 0);
+    const int headerSize = ret.size();
+
+    append<quint32>(ret, quint32(columnCount));
+    if(columnar)
+    {
+        for(const QString& field: snapshot.fields())
+            appendString(ret, field);
+    }
+
+    append<quint32>(ret, quint32(stringTable.count()));
+    for(const QString& string: qAsConst(stringTable))
+        appendString(ret, string);
+
+    for(int column = 0; column < columnCount; ++column)
+        writeColumn(ret, rows, column, types.at(column), strings);
+
+    const qint64 payloadSize = ret.size() - headerSize;
+    qToLittleEndian(crc32(ret.constData() + headerSize, payloadSize), ret.data() + headerSize - 12);
+    qToLittleEndian(quint64(payloadSize), ret.data() + headerSize - 8);
+
+    return ret;
+}
+
+bool QVariantListBinary::read(const char* data, qint64 size, QStringList& fields, bool& columnar, QVector<Row>& rows)
+{
+    Reader header(data, size);
+    const quint32 magic = header.read<quint32>();
+    const quint32 version = header.read<quint32>();
+    const quint32 flags = header.read<quint32>();
+    const quint32 rowCount = header.read<quint32>();
+    const quint32 checksum = header.read<quint32>();
+    const quint64 payloadSize = header.read<quint64>();
+    const char* payload = header.take(qint64(payloadSize));
+
+    if(!header.isValid() || magic != Magic || version > Version)
+        return false;
+
+    if(crc32(payload, qint64(payloadSize)) != checksum)
+        return false;
+
+    Reader reader(payload, qint64(payloadSize));
+    columnar = flags & 1;
+
+    const quint32 columnCount = reader.read<quint32>();
+    // Every column takes at least its type byte
+    if(qint64(columnCount) > reader.remaining())
+        return false;
+
+    fields.clear();
+    if(columnar)
+    {
+        for(quint32 column = 0; column < columnCount && reader.isValid(); ++column)
+            fields.append(reader.readString());
+    }
+
+    const quint32 stringCount = reader.read<quint32>();
+    QVector<QString> strings;
+    for(quint32 i = 0; i < stringCount && reader.isValid(); ++i)
+        strings.append(reader.readString());
+
+    if(!reader.isValid() || (!columnar && columnCount != 1) || rowCount > quint32(std::numeric_limits<int>::max()))
+        return false;
+
+    // The counts of the header are checked against the column blocks before anything is allocated
+    const int bitmapSize = int((rowCount + 7) / 8);
+    Reader blocks = reader;
+    bool hasValues = false;
+    quint32 rowSize = 0;
+    for(quint32 column = 0; column < columnCount && blocks.isValid(); ++column)
+    {
+        qint64 valueSize = 0;
+        switch(ColumnType(blocks.read<quint8>()))
+        {
+        case EmptyColumn:
+            continue;
+        case VariantColumn:
+        {
+            // A streamed variant takes at least its type
+            const quint64 blobSize = blocks.read<quint64>();
+            if(blobSize < quint64(rowCount) * 4)
+                return false;
+            blocks.take(qint64(blobSize));
+            hasValues = true;
+            rowSize = column + 1;
+            continue;
+        }
+        case IntColumn:
+        case StringColumn:
+            valueSize = 4;
+            break;
+        case LongLongColumn:
+        case DoubleColumn:
+            valueSize = 8;
+            break;
+        case BoolColumn:
+            valueSize = 1;
+            break;
+        default:
+            return false;
+        }
+        blocks.take(bitmapSize + qint64(rowCount) * valueSize);
+        hasValues = true;
+        rowSize = column + 1;
+    }
+
+    // Rows without any value take no room in the file, there can't be more than bits in the payload
+    if(!blocks.isValid() || (!hasValues && qint64(rowCount) > qint64(payloadSize) * 8))
+        return false;
+
+    // Rows stop at their last column holding values, the model reads the missing cells as empty
+    rows = QVector<Row>(int(rowCount), Row(int(rowSize)));
+    for(int column = 0; column < int(columnCount); ++column)
+    {
+        const ColumnType type = ColumnType(reader.read<quint8>());
+        if(type == EmptyColumn)
+            continue;
+
+        if(type == VariantColumn)
+        {
+            const quint64 blobSize = reader.read<quint64>();
+            const char* blob = reader.take(qint64(blobSize));
+            if(!blob)
+                return false;
+
+            QDataStream stream(QByteArray::fromRawData(blob, int(blobSize)));
+            stream.setVersion(QDataStream::Qt_5_12);
+            for(int row = 0; row < int(rowCount); ++row)
+                stream >> rows[row][column];
+            if(stream.status() != QDataStream::Ok)
+                return false;
+            continue;
+        }
+
+        const char* bitmap = reader.take(bitmapSize);
+        for(int row = 0; row < int(rowCount) && reader.isValid(); ++row)
+        {
+            QVariant value;
+            switch(type)
+            {
+            case IntColumn:
+                value = QVariant(reader.read<qint32>());
+                break;
+            case LongLongColumn:
+                value = QVariant(reader.read<qint64>());
+                break;
+            case DoubleColumn:
+                value = QVariant(reader.readDouble());
+                break;
+            case BoolColumn:
+                value = QVariant(reader.read<quint8>() != 0);
+                break;
+            case StringColumn:
+                // Every cell holding the same string shares the table entry
+                value = QVariant(strings.value(int(reader.read<quint32>())));
+                break;
+            default:
+                return false;
+            }
+
+            if(bitmap[row / 8] & (1 << (row % 8)))
+                rows[row][column] = value;
+        }
+
+        if(!reader.isValid())
+            return false;
+    }
+
+    return true;
+}
+
+quint32 QVariantListBinary::crc32(const char* data, qint64 size)
+{
+    static const QVector<quint32> table = []() {
+        QVector<quint32> ret(256);
+        for(quint32 n = 0; n < 256; ++n)
+        {
+            quint32 c = n;
+            for(int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            ret[int(n)] = c;
+        }
+        return ret;
+    }();
+
+    const quint32* lookup = table.constData();
+    quint32 crc = 0xFFFFFFFFu;
+    for(qint64 i = 0; i < size; ++i)
+        crc = lookup[(crc ^ uchar(data[i])) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+QVariantListBinary::ColumnType QVariantListBinary::columnType(const QVariantListRows& rows, int column)
+{
+    int userType = QMetaType::UnknownType;
+    for(int row = 0; row < rows.count(); ++row)
+    {
+        const QVariant& value = rows.at(row).value(column);
+        if(!value.isValid())
+            continue;
+        if(userType == QMetaType::UnknownType)
+            userType = value.userType();
+        else if(userType != value.userType())
+            return VariantColumn;
+    }
+
+    switch(userType)
+    {
+    case QMetaType::UnknownType:
+        return EmptyColumn;
+    case QMetaType::Int:
+        return IntColumn;
+    case QMetaType::LongLong:
+        return LongLongColumn;
+    case QMetaType::Double:
+        return DoubleColumn;
+    case QMetaType::Bool:
+        return BoolColumn;
+    case QMetaType::QString:
+        return StringColumn;
+    default:
+        return VariantColumn;
+    }
+}
+
+void QVariantListBinary::writeColumn(QByteArray& out, const QVariantListRows& rows, int column, ColumnType type, const QHash<QString, quint32>& strings)
+{
+    append<quint8>(out, quint8(type));
+    if(type == EmptyColumn)
+        return;
+
+    if(type == VariantColumn)
+    {
+        QByteArray blob;
+        QDataStream stream(&blob, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_12);
+        for(int row = 0; row < rows.count(); ++row)
+            stream << rows.at(row).value(column);
+
+        append<quint64>(out, quint64(blob.size()));
+        out.append(blob);
+        return;
+    }
+
+    // One bit per row tells the valid cells from the empty ones
+    QByteArray bitmap((rows.count() + 7) / 8, 0);
+    for(int row = 0; row < rows.count(); ++row)
+    {
+        if(rows.at(row).value(column).isValid())
+            bitmap[row / 8] = char(bitmap.at(row / 8) | (1 << (row % 8)));
+    }
+    out.append(bitmap);
+
+    out.reserve(out.size() + rows.count() * 8);
+    for(int row = 0; row < rows.count(); ++row)
+    {
+        const QVariant& value = rows.at(row).value(column);
+        switch(type)
+        {
+        case IntColumn:
+            append<qint32>(out, value.toInt());
+            break;
+        case LongLongColumn:
+            append<qint64>(out, value.toLongLong());
+            break;
+        case DoubleColumn:
+            appendDouble(out, value.toDouble());
+            break;
+        case BoolColumn:
+            append<quint8>(out, value.toBool() ? 1 : 0);
+            break;
+        case StringColumn:
+            append<quint32>(out, value.isValid() ? strings.value(value.toString()) : 0);
+            break;
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef QVARIANTLISTBINARY_H
+#define QVARIANTLISTBINARY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+#include "qvariantlistrows.h"
+#include "qvariantlistsnapshot.h"
+
+// Binary persistence of the rows of a QVariantListModel.
+// A header (magic, version, flags, row count, CRC-32 and size of the payload) is followed by the fields,
+// a table of the distinct strings, then one block per column holding its values in a typed array.
+// Integers and doubles are stored little endian, columns mixing types fall back to QDataStream.
+class QVariantListBinary
+{
+public:
+    using Row = QVariantListRows::Row;
+
+    static const quint32 Magic = 0x4d4c5651;
+    static const quint32 Version = 1;
+
+    static QByteArray write(const QVariantListSnapshot& snapshot);
+    static bool read(const char* data, qint64 size, QStringList& fields, bool& columnar, QVector<Row>& rows);
+
+    static quint32 crc32(const char* data, qint64 size);
+
+private:
+    enum ColumnType {
+        EmptyColumn,
+        IntColumn,
+        LongLongColumn,
+        DoubleColumn,
+        BoolColumn,
+        StringColumn,
+        VariantColumn
+    };
+
+    static ColumnType columnType(const QVariantListRows& rows, int column);
+    static void writeColumn(QByteArray& out, const QVariantListRows& rows, int column, ColumnType type, const QHash<QString, quint32>& strings);
+};
+
+#endif // QVARIANTLISTBINARY_H
@@ -0,0 +1,283 @@
+#include "qvariantlistfieldindex.h"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+QVariantListFieldIndex::QVariantListFieldIndex(Type type) :
+    m_type(type)
+{
+
+}
+
+void QVariantListFieldIndex::invalidate()
+{
+    m_valid = false;
+    m_buckets.clear();
+    m_order.clear();
+}
+
+void QVariantListFieldIndex::build(const Rows& rows, int column)
+{
+    invalidate();
+
+    if(m_type == Hash)
+    {
+        m_buckets.reserve(rows.count());
+        for(int row = 0; row < rows.count(); ++row)
+            m_buckets[hashKey(rows.at(row).value(column))].append(row);
+    }
+    else
+    {
+        m_order.resize(rows.count());
+        std::iota(m_order.begin(), m_order.end(), 0);
+        std::stable_sort(m_order.begin(), m_order.end(), [&rows, column](int a, int b) {
+            return rows.at(a).value(column) < rows.at(b).value(column);
+        });
+    }
+
+    m_valid = true;
+}
+
+void QVariantListFieldIndex::update(int row, const QVariant& before, const QVariant& after)
+{
+    if(!m_valid || before == after)
+        return;
+
+    // Moving a row inside the sorted order isn't worth it, sort again on next query
+    if(m_type == Ordered)
+    {
+        invalidate();
+        return;
+    }
+
+    const QString beforeKey = hashKey(before);
+    const QString afterKey = hashKey(after);
+    if(beforeKey == afterKey)
+        return;
+
+    QVector<int>& beforeBucket = m_buckets[beforeKey];
+    const auto it = std::lower_bound(beforeBucket.begin(), beforeBucket.end(), row);
+    if(it != beforeBucket.end() && *it == row)
+        beforeBucket.erase(it);
+    if(beforeBucket.isEmpty())
+        m_buckets.remove(beforeKey);
+
+    QVector<int>& afterBucket = m_buckets[afterKey];
+    afterBucket.insert(std::lower_bound(afterBucket.begin(), afterBucket.end(), row), row);
+}
+
+void QVariantListFieldIndex::insertRows(const Rows& rows, int column, int first, int count)
+{
+    if(!m_valid || count <= 0)
+        return;
+
+    // Rebuilding is cheaper than inserting most of the rows one by one
+    if(count * 2 > rows.count())
+    {
+        invalidate();
+        return;
+    }
+
+    if(first + count < rows.count())
+        shiftRows(first, count);
+
+    if(m_type == Hash)
+    {
+        for(int row = first; row < first + count; ++row)
+        {
+            QVector<int>& bucket = m_buckets[hashKey(rows.at(row).value(column))];
+            bucket.insert(std::lower_bound(bucket.begin(), bucket.end(), row), row);
+        }
+        return;
+    }
+
+    // The new rows are sorted apart and merged in a single pass
+    QVector<int> inserted(count);
+    std::iota(inserted.begin(), inserted.end(), first);
+    const auto lessThan = [&rows, column](int a, int b) {
+        return rows.at(a).value(column) < rows.at(b).value(column);
+    };
+    std::stable_sort(inserted.begin(), inserted.end(), lessThan);
+
+    QVector<int> order;
+    order.reserve(m_order.count() + count);
+    std::merge(m_order.cbegin(), m_order.cend(), inserted.cbegin(), inserted.cend(), std::back_inserter(order), lessThan);
+    m_order = order;
+}
+
+void QVariantListFieldIndex::removeRows(const Rows& rows, int column, int first, int count)
+{
+    if(!m_valid || count <= 0)
+        return;
+
+    if(count * 2 > rows.count())
+    {
+        invalidate();
+        return;
+    }
+
+    const int last = first + count - 1;
+    if(m_type == Hash)
+    {
+        for(int row = first; row <= last; ++row)
+        {
+            const QString key = hashKey(rows.at(row).value(column));
+            QVector<int>& bucket = m_buckets[key];
+            const auto it = std::lower_bound(bucket.begin(), bucket.end(), row);
+            if(it != bucket.end() && *it == row)
+                bucket.erase(it);
+            if(bucket.isEmpty())
+                m_buckets.remove(key);
+        }
+    }
+    else
+    {
+        m_order.erase(std::remove_if(m_order.begin(), m_order.end(), [first, last](int row) {
+            return row >= first && row <= last;
+        }), m_order.end());
+    }
+
+    if(last + 1 < rows.count())
+        shiftRows(last + 1, -count);
+}
+
+void QVariantListFieldIndex::shiftRows(int from, int delta)
+{
+    const auto shift = [from, delta](int& row) {
+        if(row >= from)
+            row += delta;
+    };
+
+    if(m_type == Hash)
+    {
+        for(QVector<int>& bucket: m_buckets)
+            std::for_each(bucket.begin(), bucket.end(), shift);
+    }
+    else
+    {
+        std::for_each(m_order.begin(), m_order.end(), shift);
+    }
+}
+
+QVector<int> QVariantListFieldIndex::find(const Rows& rows, int column, const QVariant& value) const
+{
+    QVector<int> ret;
+    if(!m_valid)
+        return ret;
+
+    if(m_type == Hash)
+    {
+        if(isFuzzy(value))
+            return scan(rows, column, value, false);
+
+        // Different values can share a key, the bucket is only a candidate list
+        for(int row: m_buckets.value(hashKey(value)))
+        {
+            if(rows.at(row).value(column) == value)
+                ret.append(row);
+        }
+    }
+    else
+    {
+        ret = findRange(rows, column, value, value);
+        ret.erase(std::remove_if(ret.begin(), ret.end(), [&rows, column, &value](int row) {
+            return rows.at(row).value(column) != value;
+        }), ret.end());
+    }
+
+    return ret;
+}
+
+int QVariantListFieldIndex::findFirst(const Rows& rows, int column, const QVariant& value) const
+{
+    if(!m_valid)
+        return -1;
+
+    if(m_type == Hash)
+    {
+        if(isFuzzy(value))
+        {
+            const QVector<int> matches = scan(rows, column, value, true);
+            return matches.isEmpty() ? -1 : matches.first();
+        }
+
+        // Buckets are sorted, the first match is the lowest row
+        for(int row: m_buckets.value(hashKey(value)))
+        {
+            if(rows.at(row).value(column) == value)
+                return row;
+        }
+        return -1;
+    }
+
+    const QVector<int> ret = find(rows, column, value);
+    return ret.isEmpty() ? -1 : ret.first();
+}
+
+QVector<int> QVariantListFieldIndex::scan(const Rows& rows, int column, const QVariant& value, bool first) const
+{
+    QVector<int> ret;
+    for(int row = 0; row < rows.count(); ++row)
+    {
+        if(rows.at(row).value(column) != value)
+            continue;
+
+        ret.append(row);
+        if(first)
+            break;
+    }
+    return ret;
+}
+
+QVector<int> QVariantListFieldIndex::findRange(const Rows& rows, int column, const QVariant& from, const QVariant& to) const
+{
+    QVector<int> ret;
+    if(!m_valid || m_type != Ordered)
+        return ret;
+
+    const auto first = std::lower_bound(m_order.cbegin(), m_order.cend(), from, [&rows, column](int row, const QVariant& value) {
+        return rows.at(row).value(column) < value;
+    });
+    const auto last = std::upper_bound(first, m_order.cend(), to, [&rows, column](const QVariant& value, int row) {
+        return value < rows.at(row).value(column);
+    });
+
+    ret.reserve(int(last - first));
+    std::copy(first, last, std::back_inserter(ret));
+    std::sort(ret.begin(), ret.end());
+
+    return ret;
+}
+
+QString QVariantListFieldIndex::hashKey(const QVariant& value)
+{
+    // QVariant compares numbers and booleans by value whatever their type, true equals 1 and 2 equals 2.0.
+    // They share a key through their double, rounded so that the values close enough to compare equal
+    // to an integer land in its bucket.
+    switch(value.userType())
+    {
+    case QMetaType::Bool:
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Double:
+    case QMetaType::Float:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Long:
+    case QMetaType::ULong:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::UChar:
+        return QString::number(value.toDouble(), 'g', 12);
+    default:
+        return value.toString();
+    }
+}
+
+bool QVariantListFieldIndex::isFuzzy(const QVariant& value)
+{
+    return value.userType() == QMetaType::Double || value.userType() == QMetaType::Float;
+}
@@ -0,0 +1,57 @@
+#ifndef QVARIANTLISTFIELDINDEX_H
+#define QVARIANTLISTFIELDINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+#include "qvariantlistrows.h"
+
+// Secondary index on one field of the rows of a QVariantListModel.
+// Inserted and removed rows and single cell edits are applied in place, it is rebuilt lazily
+// after the other structural changes.
+class QVariantListFieldIndex
+{
+public:
+    using Rows = QVariantListRows;
+
+    enum Type {
+        Hash,
+        Ordered
+    };
+
+    explicit QVariantListFieldIndex(Type type = Hash);
+
+    Type type() const { return m_type; }
+    bool isValid() const { return m_valid; }
+
+    void invalidate();
+    void build(const Rows& rows, int column);
+    void update(int row, const QVariant& before, const QVariant& after);
+    // After count rows were inserted at first
+    void insertRows(const Rows& rows, int column, int first, int count);
+    // Before count rows at first are removed
+    void removeRows(const Rows& rows, int column, int first, int count);
+
+    QVector<int> find(const Rows& rows, int column, const QVariant& value) const;
+    // First row holding value, -1 when none
+    int findFirst(const Rows& rows, int column, const QVariant& value) const;
+    QVector<int> findRange(const Rows& rows, int column, const QVariant& from, const QVariant& to) const;
+
+private:
+    static QString hashKey(const QVariant& value);
+    // Floating point values compare fuzzily, no key catches all the values equal to them
+    static bool isFuzzy(const QVariant& value);
+    QVector<int> scan(const Rows& rows, int column, const QVariant& value, bool first) const;
+    // Adds delta to the rows from from onward
+    void shiftRows(int from, int delta);
+
+    Type m_type;
+    bool m_valid=false;
+
+    QHash<QString, QVector<int>> m_buckets;
+    QVector<int> m_order;
+};
+
+#endif // QVARIANTLISTFIELDINDEX_H
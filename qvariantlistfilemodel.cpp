@@ -0,0 +1,276 @@
+#include "qvariantlistfilemodel.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QThreadPool>
+#include <QTimer>
+
+// ──────── CONSTRUCTOR ──────────
+QVariantListFileModel::QVariantListFileModel(QObject * parent) :
+    QVariantListModel(parent)
+{
+
+}
+
+QVariantListFileModel::~QVariantListFileModel()
+{
+    if(m_loader)
+        m_loader->cancel();
+}
+
+// ──────── PUBLIC API ──────────
+bool QVariantListFileModel::loading() const
+{
+    return !m_loader.isNull();
+}
+
+qreal QVariantListFileModel::progress() const
+{
+    return m_progress;
+}
+
+int QVariantListFileModel::loadBatchSize() const
+{
+    return m_loadBatchSize;
+}
+
+bool QVariantListFileModel::setLoadBatchSize(int batchSize)
+{
+    if(m_loadBatchSize==batchSize)
+        return false;
+    m_loadBatchSize=batchSize;
+    emit this->loadBatchSizeChanged(m_loadBatchSize);
+    return true;
+}
+
+void QVariantListFileModel::cancelLoading()
+{
+    if(!m_loader)
+        return;
+
+    m_loader->cancel();
+    QObject::disconnect(m_loader.data(), nullptr, this, nullptr);
+    m_loader.reset();
+    loadingInvalidate();
+    emit this->loaded(false);
+}
+
+// ──────── ASYNC LOADING ──────────
+bool QVariantListFileModel::loadAsync(const std::function<bool(QVariantListLoader* loader)>& parse, bool diff)
+{
+    cancelLoading();
+
+    // The pool thread may outlive the model, it shares the loader and deletes it on the model thread
+    QSharedPointer<QVariantListLoader> loader(new QVariantListLoader(diff ? 0 : m_loadBatchSize), &QObject::deleteLater);
+    QObject::connect(loader.data(), &QVariantListLoader::itemsReady, this, &QVariantListFileModel::onLoaderItems);
+    QObject::connect(loader.data(), &QVariantListLoader::rowsReady, this, &QVariantListFileModel::onLoaderRows);
+    QObject::connect(loader.data(), &QVariantListLoader::progressChanged, this, &QVariantListFileModel::onLoaderProgress);
+    QObject::connect(loader.data(), &QVariantListLoader::finished, this, &QVariantListFileModel::onLoaderFinished);
+
+    m_loader = loader;
+    m_loaderDelivered = false;
+    m_loaderDiff = diff;
+    updateProgress(0);
+    loadingInvalidate();
+
+    QThreadPool::globalInstance()->start([loader, parse]() {
+        loader->finish(parse(loader.data()));
+    });
+
+    return true;
+}
+
+void QVariantListFileModel::onLoaderItems(const QVariantList& items)
+{
+    // Signals queued by a canceled loader are still delivered
+    if(sender() != m_loader.data())
+        return;
+
+    applyLoaderItems(items);
+}
+
+void QVariantListFileModel::onLoaderRows(const QStringList& fields, const QVector<Row>& rows)
+{
+    if(sender() != m_loader.data())
+        return;
+
+    // Rows replacing the model are stored as they are, in the order of their fields
+    const bool reset = !m_loaderDiff && (m_loadBatchSize <= 0 ? keyField().isEmpty() || isEmpty() : !m_loaderDelivered);
+    if(reset)
+    {
+        resetRows(fields, true, rows);
+        m_loaderDelivered = true;
+        return;
+    }
+
+    // Diffed and appended rows go through items, once the new fields are appended in order
+    appendFields(fields);
+    QVariantList items;
+    items.reserve(rows.count());
+    for(const Row& row: rows)
+    {
+        QVariantMap map;
+        for(int i = 0; i < row.count(); ++i)
+        {
+            if(row.at(i).isValid())
+                map.insert(fields.at(i), row.at(i));
+        }
+        items.append(map);
+    }
+    applyLoaderItems(items);
+}
+
+void QVariantListFileModel::applyLoaderItems(const QVariantList& items)
+{
+    if(m_loaderDiff)
+    {
+        // setStorage() already diffs by key
+        if(keyField().isEmpty() || isEmpty())
+            diffStorageByPosition(items);
+        else
+            setStorage(items);
+    }
+    else if(m_loadBatchSize <= 0)
+    {
+        setStorage(items);
+    }
+    else
+    {
+        // The first batch replaces the rows, the next ones are appended
+        if(!m_loaderDelivered)
+            clear();
+        insert(count(), QVariant(items));
+    }
+    m_loaderDelivered = true;
+}
+
+void QVariantListFileModel::onLoaderProgress(qreal progress)
+{
+    if(sender() != m_loader.data())
+        return;
+    updateProgress(progress);
+}
+
+void QVariantListFileModel::updateProgress(qreal progress)
+{
+    if(qFuzzyCompare(1 + m_progress, 1 + progress))
+        return;
+    m_progress = progress;
+    emit this->progressChanged(m_progress);
+}
+
+void QVariantListFileModel::onLoaderFinished(bool ok)
+{
+    if(sender() != m_loader.data())
+        return;
+
+    if(ok)
+    {
+        if(!m_loaderDelivered)
+            clear();
+        updateProgress(1);
+    }
+
+    m_loader.reset();
+    loadingInvalidate();
+    emit this->loaded(ok);
+}
+
+void QVariantListFileModel::loadingInvalidate()
+{
+    emit this->loadingChanged(loading());
+}
+
+bool QVariantListFileModel::watch() const
+{
+    return m_watch;
+}
+
+bool QVariantListFileModel::setWatch(bool watch)
+{
+    if(m_watch==watch)
+        return false;
+    m_watch=watch;
+    updateWatcher();
+    emit this->watchChanged(m_watch);
+    return true;
+}
+
+int QVariantListFileModel::watchDelay() const
+{
+    return m_watchDelay;
+}
+
+bool QVariantListFileModel::setWatchDelay(int delay)
+{
+    if(m_watchDelay==delay)
+        return false;
+    m_watchDelay=delay;
+    if(m_watchTimer)
+        m_watchTimer->setInterval(m_watchDelay);
+    emit this->watchDelayChanged(m_watchDelay);
+    return true;
+}
+
+void QVariantListFileModel::setWatchedFile(const QString& path, const std::function<bool(QVariantListLoader* loader)>& parse)
+{
+    m_watchedPath = QFileInfo(path).absoluteFilePath();
+    m_watchParse = parse;
+    updateWatcher();
+}
+
+void QVariantListFileModel::updateWatcher()
+{
+    if(!m_watch || m_watchedPath.isEmpty())
+    {
+        delete m_watcher;
+        m_watcher = nullptr;
+        delete m_watchTimer;
+        m_watchTimer = nullptr;
+        return;
+    }
+
+    if(!m_watcher)
+    {
+        // Writers often truncate then write, or write by parts: the reload waits for the file to settle
+        m_watchTimer = new QTimer(this);
+        m_watchTimer->setSingleShot(true);
+        m_watchTimer->setInterval(m_watchDelay);
+        QObject::connect(m_watchTimer, &QTimer::timeout, this, &QVariantListFileModel::reloadWatchedFile);
+
+        m_watcher = new QFileSystemWatcher(this);
+        QObject::connect(m_watcher, &QFileSystemWatcher::fileChanged, m_watchTimer, QOverload<>::of(&QTimer::start));
+        QObject::connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &QVariantListFileModel::onWatchedDirectoryChanged);
+    }
+
+    if(!m_watcher->files().isEmpty())
+        m_watcher->removePaths(m_watcher->files());
+    if(!m_watcher->directories().isEmpty())
+        m_watcher->removePaths(m_watcher->directories());
+
+    // The directory tells when the file is created again after a removal or replaced by a rename
+    m_watcher->addPath(QFileInfo(m_watchedPath).absolutePath());
+    if(QFile::exists(m_watchedPath))
+        m_watcher->addPath(m_watchedPath);
+}
+
+void QVariantListFileModel::onWatchedDirectoryChanged()
+{
+    if(!m_watcher->files().contains(m_watchedPath) && QFile::exists(m_watchedPath))
+    {
+        m_watcher->addPath(m_watchedPath);
+        m_watchTimer->start();
+    }
+}
+
+void QVariantListFileModel::reloadWatchedFile()
+{
+    // A rename over the file removes it from the watcher
+    if(!QFile::exists(m_watchedPath))
+        return;
+    if(!m_watcher->files().contains(m_watchedPath))
+        m_watcher->addPath(m_watchedPath);
+
+    loadAsync(m_watchParse, true);
+}
@@ -0,0 +1,96 @@
+#ifndef QVARIANTLISTFILEMODEL_H
+#define QVARIANTLISTFILEMODEL_H
+
+#include <QSharedPointer>
+
+#include <functional>
+
+#include "qvariantlistloader.h"
+#include "qvariantlistmodel.h"
+
+class QFileSystemWatcher;
+class QTimer;
+
+// Base of the QVariantListModel loaded from files: background loading, its progress,
+// and the reload of the file when it changes on disk
+class QVariantListFileModel: public QVariantListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
+    Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(int loadBatchSize READ loadBatchSize WRITE setLoadBatchSize NOTIFY loadBatchSizeChanged)
+    Q_PROPERTY(bool watch READ watch WRITE setWatch NOTIFY watchChanged)
+    Q_PROPERTY(int watchDelay READ watchDelay WRITE setWatchDelay NOTIFY watchDelayChanged)
+
+    // ──────── CONSTRUCTOR ──────────
+public:
+    explicit QVariantListFileModel(QObject * parent = nullptr);
+    ~QVariantListFileModel() override;
+
+    // ──────── PUBLIC API ──────────
+public:
+    bool loading() const;
+    qreal progress() const;
+    int loadBatchSize() const;
+    bool setLoadBatchSize(int batchSize);
+    Q_INVOKABLE void cancelLoading();
+
+    bool watch() const;
+    bool setWatch(bool watch);
+    int watchDelay() const;
+    bool setWatchDelay(int delay);
+
+signals:
+    void loadingChanged(bool loading);
+    void progressChanged(qreal progress);
+    void loadBatchSizeChanged(int batchSize);
+    // A background load ended, ok is false when it failed or was canceled
+    void loaded(bool ok);
+    void watchChanged(bool watch);
+    void watchDelayChanged(int delay);
+
+    // ──────── ASYNC LOADING ──────────
+protected:
+    // Runs parse on the global thread pool. The items it appends to the loader replace the rows,
+    // at once or by batches of loadBatchSize items. When diff is set, they are applied at once
+    // as the minimal row changes, matching the rows by keyField or else by position
+    bool loadAsync(const std::function<bool(QVariantListLoader* loader)>& parse, bool diff = false);
+
+private:
+    void onLoaderItems(const QVariantList& items);
+    void onLoaderRows(const QStringList& fields, const QVector<Row>& rows);
+    void applyLoaderItems(const QVariantList& items);
+    void onLoaderProgress(qreal progress);
+    void updateProgress(qreal progress);
+    void onLoaderFinished(bool ok);
+    void loadingInvalidate();
+
+    // ──────── FILE WATCHING ──────────
+protected:
+    // While watch is set, the file is parsed again by parse after it changed and the rows are diffed
+    void setWatchedFile(const QString& path, const std::function<bool(QVariantListLoader* loader)>& parse);
+
+private:
+    void updateWatcher();
+    void onWatchedDirectoryChanged();
+    void reloadWatchedFile();
+
+    // ──────── ATTRIBUTES ──────────
+private:
+    // Background load in progress, if any
+    QSharedPointer<QVariantListLoader> m_loader;
+    bool m_loaderDelivered=false;
+    bool m_loaderDiff=false;
+    qreal m_progress=0;
+    int m_loadBatchSize=0;
+
+    // File reloaded while watch is set, changes are debounced by watchDelay ms
+    bool m_watch=false;
+    int m_watchDelay=200;
+    QString m_watchedPath;
+    std::function<bool(QVariantListLoader* loader)> m_watchParse;
+    QFileSystemWatcher* m_watcher=nullptr;
+    QTimer* m_watchTimer=nullptr;
+};
+
+#endif // QVARIANTLISTFILEMODEL_H
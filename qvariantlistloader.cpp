@@ -0,0 +1,95 @@
+#include "qvariantlistloader.h"
+
+QVariantListLoader::QVariantListLoader(int batchSize, QObject* parent) :
+    QObject(parent),
+    m_batchSize(batchSize)
+{
+
+}
+
+bool QVariantListLoader::isCanceled() const
+{
+    return m_canceled.loadAcquire() != 0;
+}
+
+void QVariantListLoader::cancel()
+{
+    m_canceled.storeRelease(1);
+}
+
+bool QVariantListLoader::append(const QVariant& item)
+{
+    if(isCanceled())
+        return false;
+
+    m_items.append(item);
+    if(m_batchSize > 0 && m_items.count() >= m_batchSize)
+        flush();
+
+    return true;
+}
+
+bool QVariantListLoader::appendRow(const QStringList& fields, const Row& row)
+{
+    if(isCanceled())
+        return false;
+
+    m_fields = fields;
+    m_rows.append(row);
+    if(m_batchSize > 0 && m_rows.count() >= m_batchSize)
+        flush();
+
+    return true;
+}
+
+void QVariantListLoader::setProgress(qint64 position, qint64 total)
+{
+    // Only report whole permilles, the model thread doesn't need more
+    const int permille = total > 0 ? int(qBound(qint64(0), position * 1000 / total, qint64(1000))) : 0;
+    if(permille == m_permille)
+        return;
+
+    m_permille = permille;
+    emit this->progressChanged(permille / 1000.0);
+}
+
+void QVariantListLoader::finish(bool ok)
+{
+    if(isCanceled())
+        return;
+
+    if(ok)
+        flush();
+    emit this->finished(ok);
+}
+
+QVariantListLoader::Sink QVariantListLoader::sink(qint64 total)
+{
+    return [this, total](const QVariant& item, qint64 position) {
+        setProgress(position, total);
+        return append(item);
+    };
+}
+
+QVariantListLoader::RowSink QVariantListLoader::rowSink(qint64 total)
+{
+    return [this, total](const QStringList& fields, const Row& row, qint64 position) {
+        setProgress(position, total);
+        return appendRow(fields, row);
+    };
+}
+
+void QVariantListLoader::flush()
+{
+    if(!m_items.isEmpty())
+    {
+        emit this->itemsReady(m_items);
+        m_items.clear();
+    }
+
+    if(!m_rows.isEmpty())
+    {
+        emit this->rowsReady(m_fields, m_rows);
+        m_rows.clear();
+    }
+}
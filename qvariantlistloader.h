@@ -0,0 +1,59 @@
+#ifndef QVARIANTLISTLOADER_H
+#define QVARIANTLISTLOADER_H
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QVariant>
+
+#include <functional>
+
+#include "qvariantlistrows.h"
+
+// Carries the items parsed by a background load to a QVariantListModel.
+// The parser calls it from a pool thread, its signals are delivered on the thread of the model.
+class QVariantListLoader: public QObject
+{
+    Q_OBJECT
+
+public:
+    // Receives each parsed item with the number of bytes read so far, returns false to stop parsing
+    using Sink = std::function<bool(const QVariant& item, qint64 position)>;
+    using Row = QVariantListRows::Row;
+    // Receives each parsed row, holding one value per field of fields
+    using RowSink = std::function<bool(const QStringList& fields, const Row& row, qint64 position)>;
+
+    explicit QVariantListLoader(int batchSize, QObject* parent = nullptr);
+
+    bool isCanceled() const;
+    void cancel();
+
+    // Returns false once the load is canceled
+    bool append(const QVariant& item);
+    // The fields only grow during a load, a row may be shorter than them
+    bool appendRow(const QStringList& fields, const Row& row);
+    void setProgress(qint64 position, qint64 total);
+    void finish(bool ok);
+
+    Sink sink(qint64 total);
+    RowSink rowSink(qint64 total);
+
+signals:
+    // A batch of items, or every item when the batch size is 0
+    void itemsReady(const QVariantList& items);
+    // A batch of rows, with the fields of their values
+    void rowsReady(const QStringList& fields, const QVector<Row>& rows);
+    void progressChanged(qreal progress);
+    void finished(bool ok);
+
+private:
+    void flush();
+
+    const int m_batchSize;
+    QAtomicInt m_canceled;
+    int m_permille=-1;
+    QVariantList m_items;
+    QStringList m_fields;
+    QVector<Row> m_rows;
+};
+
+#endif // QVARIANTLISTLOADER_H
@@ -1,6 +1,14 @@
 #include "qvariantlistmodel.h"
+#include "qvariantlistbinary.h"
+#include "qmappedfile.h"
 #include "qmodels_log.h"
 
+#include <QFile>
+#include <QMetaMethod>
+#include <QSaveFile>
+
+#include <algorithm>
+
 // ──────── CONSTRUCTOR ──────────
 QVariantListModel::QVariantListModel(QObject * parent) :
     QAbstractListModel(parent),
@@ -14,8 +22,37 @@ QVariantListModel::QVariantListModel(QObject * parent) :
     QObject::connect(this, &QAbstractItemModel::dataChanged, this, &QVariantListModel::contentInvalidate);
     QObject::connect(this, &QAbstractItemModel::rowsInserted, this, &QVariantListModel::contentInvalidate);
     QObject::connect(this, &QAbstractItemModel::rowsRemoved, this, &QVariantListModel::contentInvalidate);
+    QObject::connect(this, &QAbstractItemModel::rowsMoved, this, &QVariantListModel::contentInvalidate);
     QObject::connect(this, &QAbstractItemModel::modelReset, this, &QVariantListModel::contentInvalidate);
     QObject::connect(this, &QAbstractItemModel::layoutChanged, this, &QVariantListModel::contentInvalidate);
+
+    QObject::connect(this, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles) {
+        emit this->storageUpdated(DataChange, topLeft.row(), bottomRight.row(), roles);
+    });
+    QObject::connect(this, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int last) {
+        emit this->storageUpdated(InsertChange, first, last, {});
+    });
+    QObject::connect(this, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex&, int first, int last) {
+        emit this->storageUpdated(RemoveChange, first, last, {});
+    });
+    // A move only changes the content of the rows between its source and its destination
+    QObject::connect(this, &QAbstractItemModel::rowsMoved, this, [this](const QModelIndex&, int first, int last, const QModelIndex&, int destination) {
+        if(destination > last)
+            emit this->storageUpdated(DataChange, first, destination - 1, {});
+        else
+            emit this->storageUpdated(DataChange, destination, last, {});
+    });
+    QObject::connect(this, &QAbstractItemModel::modelReset, this, [this]() {
+        emit this->storageUpdated(ResetChange, 0, count() - 1, {});
+    });
+    QObject::connect(this, &QAbstractItemModel::layoutChanged, this, [this]() {
+        emit this->storageUpdated(ResetChange, 0, count() - 1, {});
+    });
+}
+
+QVariantListModel::~QVariantListModel()
+{
+
 }
 
 const QModelIndex& QVariantListModel::noParent()
@@ -24,23 +61,29 @@ const QModelIndex& QVariantListModel::noParent()
     return ret;
 }
 
+const QVariantMap* QVariantListModel::mapView(const QVariant& variant)
+{
+    if(variant.userType() != QMetaType::QVariantMap)
+        return nullptr;
+    return static_cast<const QVariantMap*>(variant.constData());
+}
+
 // ──────── ABSTRACT MODEL OVERRIDE ──────────
 QVariant QVariantListModel::data(const QModelIndex & index, const int role) const
 {
-    if(!index.isValid() || index.row() >= m_storage.count())
+    if(!index.isValid() || index.row() >= m_rows.count())
         return QVariant();
 
+    const Row& row = m_rows.at(index.row());
     if(role == Qt::UserRole)
     {
-        return m_storage.at(index.row());
+        return fromRow(row);
     }
-    else if(role > Qt::UserRole)
+    else if(role > Qt::UserRole && isColumnar())
     {
-        if(m_storage.at(index.row()).type() == QVariant::Map)
-        {
-            const QVariantMap& original = m_storage.at(index.row()).toMap();
-            return original[m_roleNames.value(role)];
-       }
+        const int column = role - Qt::UserRole - 1;
+        if(column < row.count())
+            return row.at(column);
     }
 
     return QVariant();
@@ -54,26 +97,37 @@ bool QVariantListModel::setData(const QModelIndex & index, const QVariant & data
         return false;
     }
 
-    if(!index.isValid() || index.row() >= m_storage.count())
+    if(!index.isValid() || index.row() >= m_rows.count())
         return false;
 
     bool ret=false;
     if(role == Qt::UserRole)
     {
-        m_storage.replace(index.row(), data);
+        if(!acceptsItem(data, isColumnar()))
+            return false;
+
+        const int columnCount = m_columns.count();
+        const Row before = m_rows.at(index.row());
+        m_rows.replace(index.row(), toRow(data));
+        columnsInvalidate(columnCount);
+        for(int column = 0; column < m_columns.count(); ++column)
+            cellInvalidate(index.row(), column, before.value(column));
+        if(!isColumnar())
+            rowsInvalidate();
         emit this->dataChanged (index, index, QVector<int>{});
         ret = true;
     }
-    else if(role > Qt::UserRole)
+    else if(role > Qt::UserRole && isColumnar())
     {
-        if(m_storage.at(index.row()).type() == QVariant::Map)
+        const int column = role - Qt::UserRole - 1;
+        if(column < m_columns.count())
         {
-//            QVariantMap original = m_storage.at(index.row()).toMap();
-//            original[m_roleNames.value(role)] = data;
-//            m_storage.replace(index.row(), original);
-
-            QVariantMap& original = *reinterpret_cast<QVariantMap*>(m_storage[index.row()].data());
-            original[m_roleNames.value(role)] = data;
+            Row& row = m_rows[index.row()];
+            if(row.count() <= column)
+                row.resize(m_columns.count());
+            const QVariant before = row.at(column);
+            row[column] = data;
+            cellInvalidate(index.row(), column, before);
             emit this->dataChanged (index, index, QVector<int>{role});
             ret = true;
         }
@@ -92,14 +146,66 @@ QHash<int, QByteArray> QVariantListModel::roleNames (void) const
 
 int QVariantListModel::rowCount (const QModelIndex & parent) const
 {
-    return (!parent.isValid() ? m_storage.count() : 0);
+    return (!parent.isValid() ? m_rows.count() : 0);
+}
+
+bool QVariantListModel::moveRows(const QModelIndex& sourceParent, int sourceRow, int count, const QModelIndex& destinationParent, int destinationChild)
+{
+    if(sourceParent.isValid() || destinationParent.isValid() || count < 1)
+        return false;
+
+    if(sourceRow < 0 || (sourceRow + count) > m_rows.size() || destinationChild < 0 || destinationChild > m_rows.size())
+    {
+        QMODELSLOG_WARNING() << "Can't move rows out of bound";
+        return false;
+    }
+
+    if(!beginMoveRows(noParent(), sourceRow, sourceRow + count - 1, noParent(), destinationChild))
+        return false;
+
+    m_rows.move(sourceRow, count, destinationChild);
+    rowsInvalidate();
+
+    endMoveRows();
+
+    return true;
+}
+
+QModelIndexList QVariantListModel::match(const QModelIndex& start, int role, const QVariant& value, int hits, Qt::MatchFlags flags) const
+{
+    // Only exact matches can be answered by a field index
+    const int matchType = int(flags & 0x0F);
+    if(matchType != Qt::MatchExactly || start.column() != 0 || start.parent().isValid() || !isIndexed(role))
+        return QAbstractListModel::match(start, role, value, hits, flags);
+
+    const QList<int> rows = indexesOf(role, value);
+    const auto first = std::lower_bound(rows.cbegin(), rows.cend(), start.row());
+
+    QModelIndexList ret;
+    auto append = [this, hits, &ret](QList<int>::const_iterator begin, QList<int>::const_iterator end) {
+        for(auto it = begin; it != end && (hits == -1 || ret.count() < hits); ++it)
+            ret.append(index(*it));
+    };
+    append(first, rows.cend());
+    if(flags & Qt::MatchWrap)
+        append(rows.cbegin(), first);
+
+    return ret;
+}
+
+bool QVariantListModel::removeRows(int row, int count, const QModelIndex& parent)
+{
+    if(parent.isValid() || count < 1)
+        return false;
+
+    return remove(row, count);
 }
 
 // ──────── PUBLIC API ──────────
 
 const QStringList& QVariantListModel::fields() const
 {
-    return m_fields;
+    return m_columns;
 }
 
 bool QVariantListModel::setFields(const QStringList& fields)
@@ -107,13 +213,15 @@ bool QVariantListModel::setFields(const QStringList& fields)
     if(!m_roleNames.isEmpty() || fields.isEmpty())
         return false;
 
-    QVariantMap map;
+    m_roleNames[Qt::UserRole] = QByteArrayLiteral("qtVariant");
+    m_columnar = true;
+    m_fieldsDeclared = true;
     for(const QString& field: fields)
-        map.insert(field, QVariant());
-    updateRoleNames(map);
-
-    m_fields = fields;
-    emit this->fieldsChanged(m_fields);
+    {
+        if(!m_columnIndexes.contains(field))
+            appendColumn(field);
+    }
+    columnsInvalidate(0);
 
     return true;
 }
@@ -164,25 +272,39 @@ bool QVariantListModel::insert(int index, const QVariant& variant)
         if(variants.isEmpty())
             return true;
 
-        updateRoleNames(variants.first());
-
-        beginInsertRows(noParent(), index, index + variants.count() - 1);
-        m_storage.reserve(m_storage.count() + variants.count());
-        int offset = 0;
+        // The first item decides the schema of an empty model, no item is inserted unless all can be stored
+        const bool columnar = m_roleNames.isEmpty() ? mapView(variants.first()) != nullptr : isColumnar();
         for(const QVariant& var: variants)
         {
-            const int idx = index+offset;
-            m_storage.insert(idx, var);
-            offset++;
+            if(!acceptsItem(var, columnar))
+                return false;
         }
+
+        // Fields are discovered while the rows are built, and announced before the rows
+        const int columnCount = m_columns.count();
+        QVector<Row> rows;
+        rows.reserve(variants.count());
+        for(const QVariant& var: variants)
+            rows.append(toRow(var));
+        columnsInvalidate(columnCount);
+
+        beginInsertRows(noParent(), index, index + rows.count() - 1);
+        m_rows.insert(index, rows);
+        rowsInsertInvalidate(index, rows.count());
         endInsertRows();
     }
     else
     {
-        updateRoleNames(variant);
+        if(!acceptsItem(variant, isColumnar()))
+            return false;
+
+        const int columnCount = m_columns.count();
+        const Row row = toRow(variant);
+        columnsInvalidate(columnCount);
 
         beginInsertRows(noParent(), index, index);
-        m_storage.insert(index, variant);
+        m_rows.insert(index, row);
+        rowsInsertInvalidate(index, 1);
         endInsertRows();
     }
 
@@ -196,51 +318,46 @@ QVariant QVariantListModel::at(const int index) const
 
 QVariant QVariantListModel::get(const int index) const
 {
-    if(index < 0 || index >= m_storage.size())
+    if(index < 0 || index >= m_rows.size())
     {
         QMODELSLOG_WARNING() << "The index" << index << "is out of bound.";
         return QVariant();
     }
-    return m_storage.at(index);
+    return fromRow(m_rows.at(index));
 }
 
 bool QVariantListModel::move(int from, int to, int count)
 {
-    if(from < 0 || (from + count - 1) >= m_storage.size())
+    if(from < 0 || (from + count - 1) >= m_rows.size())
     {
         QMODELSLOG_WARNING() << "Can't move an object whose index is out of bound";
         return false;
     }
 
-    if(to < 0 || (to + count - 1) >= m_storage.size())
+    if(to < 0 || (to + count - 1) >= m_rows.size())
     {
         QMODELSLOG_WARNING() << "Can't move an object to a position that is out of bound";
         return false;
     }
 
-    beginMoveRows(QModelIndex(), from, from + count - 1, QModelIndex(), to > from ? to + count : to);
-    for(int i = 0; i < count; ++i)
-    {
-        m_storage.move(from, to);
-    }
-    endMoveRows();
+    if(from == to)
+        return true;
 
-    return true;
+    // After the move the block starts at 'to', which is row 'to + count' before the move
+    return moveRows(noParent(), from, count, noParent(), to > from ? to + count : to);
 }
 
 bool QVariantListModel::remove(int index, int count)
 {
-    if(index < 0 || (index + count - 1) >= m_storage.size())
+    if(index < 0 || (index + count - 1) >= m_rows.size())
     {
         QMODELSLOG_WARNING() << "Can't remove an object whose index is out of bound";
         return false;
     }
 
     beginRemoveRows(noParent(), index, index + count - 1);
-    for(int i = 0; i < count; ++i)
-    {
-        m_storage.removeAt(index);
-    }
+    rowsRemoveInvalidate(index, count);
+    m_rows.remove(index, count);
     endRemoveRows();
 
     return true;
@@ -250,133 +367,1300 @@ bool QVariantListModel::remove(QList<int> indexes)
 {
     bool ret=true;
 
-    std::sort(indexes.rbegin(), indexes.rend());
+    std::sort(indexes.begin(), indexes.end());
+    indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
 
-    for(int index: indexes)
+    // Group the indexes in runs of contiguous rows
+    QVector<QPair<int, int>> runs;
+    for(int index: qAsConst(indexes))
     {
-        if(!remove(index))
+        if(index < 0 || index >= m_rows.size())
+        {
+            QMODELSLOG_WARNING() << "Can't remove an object whose index is out of bound";
             ret = false;
+        }
+        else if(!runs.isEmpty() && runs.last().second == index - 1)
+        {
+            runs.last().second = index;
+        }
+        else
+        {
+            runs.append({index, index});
+        }
+    }
+
+    if(runs.isEmpty())
+        return ret;
+
+    if(m_removeResetThreshold >= 0 && runs.count() > m_removeResetThreshold)
+    {
+        // Copy the kept rows in a single pass
+        beginResetModel();
+        QVariantListRows kept(m_rows.layout());
+        for(int i = -1; i < runs.count(); ++i)
+        {
+            const int keepBegin = (i < 0) ? 0 : runs.at(i).second + 1;
+            const int keepEnd = (i + 1 < runs.count()) ? runs.at(i + 1).first : m_rows.count();
+            for(int read = keepBegin; read < keepEnd; ++read)
+                kept.append(m_rows.at(read));
+        }
+        m_rows = kept;
+        rowsInvalidate();
+        endResetModel();
+    }
+    else
+    {
+        // Remove from the end so the remaining runs keep their indexes
+        for(int i = runs.count() - 1; i >= 0; --i)
+        {
+            const QPair<int, int>& run = runs.at(i);
+            beginRemoveRows(noParent(), run.first, run.second);
+            rowsRemoveInvalidate(run.first, run.second - run.first + 1);
+            m_rows.remove(run.first, run.second - run.first + 1);
+            endRemoveRows();
+        }
     }
+
     return ret;
 }
 
+int QVariantListModel::removeIf(const QJSValue& predicate)
+{
+    // Items are converted by the engine of the model, which only exists for models created or used in QML
+    QJSEngine* engine = qjsEngine(this);
+    if(!engine)
+    {
+        QMODELSLOG_WARNING() << "removeIf with a javascript predicate needs a model owned by a qml engine";
+        return 0;
+    }
+    if(!predicate.isCallable())
+    {
+        QMODELSLOG_WARNING() << "removeIf needs a callable predicate";
+        return 0;
+    }
+
+    QJSValue callback = predicate;
+    return removeIf([engine, &callback](const QVariant& item) {
+        return callback.call(QJSValueList{engine->toScriptValue(item)}).toBool();
+    });
+}
+
+int QVariantListModel::removeIf(const std::function<bool(const QVariant&)>& predicate)
+{
+    QList<int> indexes;
+    for(int i = 0; i < m_rows.count(); ++i)
+    {
+        if(predicate(fromRow(m_rows.at(i))))
+            indexes.append(i);
+    }
+
+    if(!indexes.isEmpty())
+        remove(indexes);
+
+    return indexes.count();
+}
+
 bool QVariantListModel::clear()
 {
-    if(m_storage.isEmpty())
+    if(m_rows.isEmpty())
         return true;
 
     beginResetModel();
-    m_storage.clear();
+    m_rows.clear();
+    clearStringPool();
+    rowsInvalidate();
     endResetModel();
 
     return true;
 }
 
+bool QVariantListModel::sort(const QString& field, Qt::SortOrder order)
+{
+    return sortBy(QStringList{field}, QList<int>{order});
+}
+
+bool QVariantListModel::sortBy(const QStringList& fields, const QList<int>& orders)
+{
+    if(!isColumnar())
+    {
+        QMODELSLOG_WARNING() << "Can't sort a model without fields";
+        return false;
+    }
+
+    QVariantListSorter sorter;
+    for(int i = 0; i < fields.count(); ++i)
+    {
+        const int column = m_columnIndexes.value(fields.at(i), -1);
+        if(column < 0)
+        {
+            QMODELSLOG_WARNING() << "Can't sort on unknown field" << fields.at(i);
+            return false;
+        }
+        sorter.addKey(column, Qt::SortOrder(orders.value(i, Qt::AscendingOrder)));
+    }
+
+    if(sorter.isEmpty() || m_rows.count() < 2)
+        return true;
+
+    const QVector<int> order = sorter.sort(m_rows);
+
+    QVector<int> positions(order.count());
+    for(int i = 0; i < order.count(); ++i)
+        positions[order.at(i)] = i;
+
+    permuteRows(positions, QAbstractItemModel::VerticalSortHint);
+
+    return true;
+}
+
 const QVariantList& QVariantListModel::storage() const
 {
+    if(m_storageDirty)
+    {
+        m_storage.clear();
+        m_storage.reserve(m_rows.count());
+        for(int i = 0; i < m_rows.count(); ++i)
+            m_storage.append(fromRow(m_rows.at(i)));
+        m_storageDirty = false;
+    }
     return m_storage;
 }
 
-bool QVariantListModel::setStorage(const QVariant& storage)
+QVariantListSnapshot QVariantListModel::snapshot() const
 {
-    beginResetModel();
-    m_storage.clear();
+    return QVariantListSnapshot(m_rows, m_columns, m_columnar, m_version);
+}
 
-    if(storage.type() == QVariant::List)
+quint64 QVariantListModel::version() const
+{
+    return m_version;
+}
+
+bool QVariantListModel::saveBinary(const QString& path) const
+{
+    QSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly))
     {
-        m_storage = storage.toList();
+        QMODELSLOG_WARNING()<<"cannot open file:"<<path;
+        return false;
     }
-    else
+
+    file.write(QVariantListBinary::write(snapshot()));
+    return file.commit();
+}
+
+bool QVariantListModel::loadBinary(const QString& path)
+{
+    // Decode straight from the mapped file when possible
+    QMappedFile file(path);
+
+    if (!file.isOpen())
+    {
+        QMODELSLOG_WARNING()<<"Error opening file:"<<file.errorString();
+        return false;
+    }
+
+    QStringList fields;
+    bool columnar=false;
+    QVector<Row> rows;
+    if(!QVariantListBinary::read(file.data(), file.size(), fields, columnar, rows))
     {
-        m_storage.append(storage);
+        QMODELSLOG_WARNING()<<"cannot load binary file:"<<path;
+        return false;
     }
 
+    return resetRows(fields, columnar, rows);
+}
+
+bool QVariantListModel::setStorage(const QVariant& storage)
+{
+    const QVariantList variants = storage.type() == QVariant::List ? storage.toList()
+                                                                   : QVariantList{storage};
+
+    if(!m_keyField.isEmpty() && !m_rows.isEmpty() && !variants.isEmpty() && diffStorage(variants))
+        return true;
+
+    const int columnCount = m_columns.count();
 
-    if(!m_storage.isEmpty())
-        updateRoleNames(m_storage.first());
+    beginResetModel();
+    m_rows.clear();
+    clearStringPool();
+
+    for(const QVariant& variant: variants)
+        m_rows.append(toRow(variant));
+    rowsInvalidate();
 
     endResetModel();
 
+    columnsInvalidate(columnCount);
+
     return true;
 }
 
-bool QVariantListModel::setSource(QAbstractItemModel* model)
+const QStringList& QVariantListModel::hashedFields() const
 {
-    if(!model)
+    return m_hashedFields;
+}
+
+bool QVariantListModel::setHashedFields(const QStringList& fields)
+{
+    if(m_hashedFields==fields)
         return false;
+    m_hashedFields=fields;
+    updateFieldIndexes();
+    emit this->hashedFieldsChanged(m_hashedFields);
+    return true;
+}
 
-    if(QVariantListModel* varModel = qobject_cast<QVariantListModel*>(model))
-        return setStorage(varModel->storage());
+const QStringList& QVariantListModel::orderedFields() const
+{
+    return m_orderedFields;
+}
 
-    beginResetModel();
-    m_storage.clear();
-    m_storage.reserve(model->rowCount());
+bool QVariantListModel::setOrderedFields(const QStringList& fields)
+{
+    if(m_orderedFields==fields)
+        return false;
+    m_orderedFields=fields;
+    updateFieldIndexes();
+    emit this->orderedFieldsChanged(m_orderedFields);
+    return true;
+}
+
+bool QVariantListModel::isIndexed(int role) const
+{
+    const int column = role - Qt::UserRole - 1;
+    return column >= 0 && column < m_columns.count() && m_fieldIndexes.contains(m_columns.at(column));
+}
 
-    const QHash<int,QByteArray> names = model->roleNames();
-    for(int i=0; i<model->rowCount(); ++i)
+int QVariantListModel::indexOf(int role, const QVariant& value) const
+{
+    const int column = role - Qt::UserRole - 1;
+    if(!isColumnar() || column < 0 || column >= m_columns.count())
+        return -1;
+
+    if(const QVariantListFieldIndex* index = fieldIndex(column))
+        return index->findFirst(m_rows, column, value);
+
+    for(int i = 0; i < m_rows.count(); ++i)
     {
-        QVariantMap map;
-        const QModelIndex modelIndex = model->index(i, 0);
-        for (QHash<int, QByteArray>::const_iterator it = names.begin(); it != names.end(); ++it)
-        {
-            map.insert(it.value(), model->data(modelIndex, it.key()));
-        }
-        m_storage.append(map);
+        if(m_rows.at(i).value(column) == value)
+            return i;
     }
+    return -1;
+}
 
-    if(!m_storage.isEmpty())
-        updateRoleNames(m_storage.first());
+QList<int> QVariantListModel::indexesOf(int role, const QVariant& value) const
+{
+    const int column = role - Qt::UserRole - 1;
+    if(!isColumnar() || column < 0 || column >= m_columns.count())
+        return QList<int>();
 
-    endResetModel();
+    if(const QVariantListFieldIndex* index = fieldIndex(column))
+        return index->find(m_rows, column, value).toList();
+
+    QList<int> ret;
+    for(int i = 0; i < m_rows.count(); ++i)
+    {
+        if(m_rows.at(i).value(column) == value)
+            ret.append(i);
+    }
+    return ret;
+}
+
+int QVariantListModel::indexOf(const QString& field, const QVariant& value) const
+{
+    const int column = m_columnIndexes.value(field, -1);
+    if(column < 0)
+        return -1;
+
+    return indexOf(Qt::UserRole + 1 + column, value);
+}
+
+QList<int> QVariantListModel::indexesOf(const QString& field, const QVariant& value) const
+{
+    const int column = m_columnIndexes.value(field, -1);
+    if(column < 0)
+        return QList<int>();
+
+    return indexesOf(Qt::UserRole + 1 + column, value);
+}
+
+QList<int> QVariantListModel::indexesInRange(const QString& field, const QVariant& from, const QVariant& to) const
+{
+    const int column = m_columnIndexes.value(field, -1);
+    if(column < 0)
+        return QList<int>();
+
+    const QVariantListFieldIndex* index = fieldIndex(column);
+    if(index && index->type() == QVariantListFieldIndex::Ordered)
+        return index->findRange(m_rows, column, from, to).toList();
+
+    QList<int> ret;
+    for(int i = 0; i < m_rows.count(); ++i)
+    {
+        const QVariant& value = m_rows.at(i).value(column);
+        if(!(value < from) && !(to < value))
+            ret.append(i);
+    }
+    return ret;
+}
+
+const QString& QVariantListModel::keyField() const
+{
+    return m_keyField;
+}
 
+bool QVariantListModel::setKeyField(const QString& keyField)
+{
+    if(m_keyField==keyField)
+        return false;
+    m_keyField=keyField;
+    emit this->keyFieldChanged(m_keyField);
     return true;
 }
 
-// ──────── ABSTRACT MODEL PRIVATE ──────────
-void QVariantListModel::countInvalidate()
+int QVariantListModel::removeResetThreshold() const
 {
-    const int aCount = count();
-    bool aEmptyChanged=false;
+    return m_removeResetThreshold;
+}
 
-    if(m_count==aCount)
-        return;
+bool QVariantListModel::setRemoveResetThreshold(int threshold)
+{
+    if(m_removeResetThreshold==threshold)
+        return false;
+    m_removeResetThreshold=threshold;
+    emit this->removeResetThresholdChanged(m_removeResetThreshold);
+    return true;
+}
 
-    if((m_count==0 && aCount!=0) || (m_count!=0 && aCount==0))
-        aEmptyChanged=true;
+bool QVariantListModel::setSource(QAbstractItemModel* model)
+{
+    if(!model)
+        return false;
 
-    m_count=aCount;
-    Q_EMIT countChanged(count());
+    if(m_source)
+        QObject::disconnect(m_source.data(), nullptr, this, nullptr);
 
-    if(aEmptyChanged)
-        Q_EMIT emptyChanged(isEmpty());
+    m_source = model;
+
+    if(m_live)
+        connectSource();
+
+    return copySource();
 }
 
-void QVariantListModel::contentInvalidate()
+QVariantListModel::StorageLayout QVariantListModel::storageLayout() const
 {
-    emit this->storageChanged(m_storage);
+    return StorageLayout(m_rows.layout());
 }
 
-void QVariantListModel::updateRoleNames(const QVariant& var)
+bool QVariantListModel::setStorageLayout(StorageLayout layout)
 {
-    if(m_roleNames.isEmpty())
-    {
-        QHash<int, QByteArray> roleNames;
-        roleNames[Qt::UserRole] = QByteArrayLiteral("qtVariant");
+    if(storageLayout()==layout)
+        return false;
+    m_rows.setLayout(QVariantListRows::Layout(layout));
+    emit this->storageLayoutChanged(layout);
+    return true;
+}
+
+bool QVariantListModel::internStrings() const
+{
+    return m_internStrings;
+}
+
+bool QVariantListModel::setInternStrings(bool internStrings)
+{
+    if(m_internStrings==internStrings)
+        return false;
+    m_internStrings=internStrings;
+    if(!m_internStrings)
+        clearStringPool();
+    emit this->internStringsChanged(m_internStrings);
+    return true;
+}
+
+qint64 QVariantListModel::internedBytes() const
+{
+    return m_internedBytes;
+}
+
+bool QVariantListModel::live() const
+{
+    return m_live;
+}
+
+bool QVariantListModel::setLive(bool live)
+{
+    if(m_live==live)
+        return false;
+    m_live=live;
 
-        if(var.type() == QVariant::Map)
+    if(m_source)
+    {
+        if(m_live)
+        {
+            // Catch up with what happened while not mirroring
+            connectSource();
+            copySource();
+        }
+        else
         {
-            const QVariantMap& firstElement = var.toMap();
-            QMapIterator<QString,QVariant> iter(firstElement);
-            int role = Qt::UserRole+1;
-
-            while (iter.hasNext())
-            {
-                iter.next();
-                roleNames[role] = iter.key().toLocal8Bit();
-                role++;
-            }
+            QObject::disconnect(m_source.data(), nullptr, this, nullptr);
         }
+    }
+
+    emit this->liveChanged(m_live);
+    return true;
+}
+
+// ──────── SOURCE MIRRORING ──────────
+bool QVariantListModel::copySource()
+{
+    if(!m_source)
+        return false;
+
+    if(QVariantListModel* varModel = qobject_cast<QVariantListModel*>(m_source.data()))
+    {
+        const bool ret = setStorage(varModel->storage());
+        const int columnCount = m_columns.count();
+        updateSourceColumns();
+        columnsInvalidate(columnCount);
+        return ret;
+    }
+
+    const int rowCount = m_source->rowCount();
+    const int columnCount = m_columns.count();
+
+    beginResetModel();
+    m_rows.clear();
+    clearStringPool();
+
+    if(rowCount > 0)
+        updateRoleNames(sourceItem(0));
+    updateSourceColumns();
 
-        m_roleNames = roleNames;
+    for(int i=0; i<rowCount; ++i)
+        m_rows.append(sourceRow(i));
+    rowsInvalidate();
+
+    endResetModel();
+
+    columnsInvalidate(columnCount);
+
+    return true;
+}
+
+void QVariantListModel::connectSource()
+{
+    QObject::connect(m_source.data(), &QAbstractItemModel::rowsInserted, this, &QVariantListModel::onSourceRowsInserted);
+    QObject::connect(m_source.data(), &QAbstractItemModel::rowsRemoved, this, &QVariantListModel::onSourceRowsRemoved);
+    QObject::connect(m_source.data(), &QAbstractItemModel::rowsMoved, this, &QVariantListModel::onSourceRowsMoved);
+    QObject::connect(m_source.data(), &QAbstractItemModel::dataChanged, this, &QVariantListModel::onSourceDataChanged);
+    QObject::connect(m_source.data(), &QAbstractItemModel::layoutAboutToBeChanged, this, &QVariantListModel::onSourceLayoutAboutToBeChanged);
+    QObject::connect(m_source.data(), &QAbstractItemModel::layoutChanged, this, &QVariantListModel::onSourceLayoutChanged);
+    QObject::connect(m_source.data(), &QAbstractItemModel::modelReset, this, &QVariantListModel::copySource);
+    if(QVariantListModel* varModel = qobject_cast<QVariantListModel*>(m_source.data()))
+        QObject::connect(varModel, &QVariantListModel::rolesAppended, this, &QVariantListModel::onSourceRolesAppended);
+}
+
+void QVariantListModel::updateSourceColumns()
+{
+    m_sourceColumns.clear();
+    if(!m_source)
+        return;
+
+    const QHash<int,QByteArray> names = m_source->roleNames();
+    for (QHash<int, QByteArray>::const_iterator it = names.begin(); it != names.end(); ++it)
+    {
+        if(!isSourceRole(it.key(), it.value()))
+            continue;
+
+        const QString field = QString::fromUtf8(it.value());
+        int column = m_columnIndexes.value(field, -1);
+        if(column < 0 && isColumnar())
+            column = appendColumn(field);
+        if(column >= 0)
+            m_sourceColumns.insert(it.key(), column);
+    }
+}
+
+QVariantMap QVariantListModel::sourceMap(int row) const
+{
+    const QHash<int,QByteArray> names = m_source->roleNames();
+    const QModelIndex modelIndex = m_source->index(row, 0);
+
+    QVariantMap map;
+    for (QHash<int, QByteArray>::const_iterator it = names.begin(); it != names.end(); ++it)
+    {
+        if(isSourceRole(it.key(), it.value()))
+            map.insert(it.value(), m_source->data(modelIndex, it.key()));
+    }
+    return map;
+}
+
+QVariant QVariantListModel::sourceItem(int row) const
+{
+    if(QVariantListModel* varModel = qobject_cast<QVariantListModel*>(m_source.data()))
+        return varModel->get(row);
+    return sourceMap(row);
+}
+
+bool QVariantListModel::isSourceRole(int role, const QByteArray& name) const
+{
+    // The whole item role of a QVariantListModel isn't a field
+    if(name == QByteArrayLiteral("qtVariant"))
+        return false;
+    return role != Qt::UserRole || !qobject_cast<QVariantListModel*>(m_source.data());
+}
+
+QVariantListModel::Row QVariantListModel::sourceRow(int row)
+{
+    if(!isColumnar())
+        return toRow(sourceItem(row));
+
+    const QModelIndex modelIndex = m_source->index(row, 0);
+
+    Row ret(m_columns.count());
+    for (QHash<int, int>::const_iterator it = m_sourceColumns.begin(); it != m_sourceColumns.end(); ++it)
+    {
+        ret[it.value()] = m_source->data(modelIndex, it.key());
+    }
+    return ret;
+}
+
+void QVariantListModel::onSourceRowsInserted(const QModelIndex& parent, int first, int last)
+{
+    if(parent.isValid())
+        return;
+
+    const int columnCount = m_columns.count();
+    if(m_roleNames.isEmpty())
+    {
+        updateRoleNames(sourceItem(first));
+        updateSourceColumns();
+    }
+
+    QVector<Row> rows;
+    rows.reserve(last - first + 1);
+    for(int i = first; i <= last; ++i)
+        rows.append(sourceRow(i));
+    columnsInvalidate(columnCount);
+
+    beginInsertRows(noParent(), first, last);
+    m_rows.insert(first, rows);
+    rowsInsertInvalidate(first, rows.count());
+    endInsertRows();
+}
+
+void QVariantListModel::onSourceRowsRemoved(const QModelIndex& parent, int first, int last)
+{
+    if(parent.isValid())
+        return;
+
+    remove(first, last - first + 1);
+}
+
+void QVariantListModel::onSourceRowsMoved(const QModelIndex& parent, int start, int end, const QModelIndex& destination, int row)
+{
+    if(parent.isValid() || destination.isValid())
+        return;
+
+    moveRows(noParent(), start, end - start + 1, noParent(), row);
+}
+
+void QVariantListModel::onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles)
+{
+    if(topLeft.parent().isValid() || topLeft.column() > 0)
+        return;
+
+    const int first = topLeft.row();
+    const int last = qMin(bottomRight.row(), m_rows.count() - 1);
+    if(first > last)
+        return;
+
+    if(!isColumnar())
+    {
+        for(int i = first; i <= last; ++i)
+            m_rows[i] = sourceRow(i);
+        rowsInvalidate();
+        emit this->dataChanged(index(first), index(last), QVector<int>{});
+        return;
+    }
+
+    // Only refresh the columns of the roles that changed
+    QVector<QPair<int, int>> columns;
+    for (QHash<int, int>::const_iterator it = m_sourceColumns.begin(); it != m_sourceColumns.end(); ++it)
+    {
+        if(roles.isEmpty() || roles.contains(it.key()))
+            columns.append({it.key(), it.value()});
+    }
+
+    if(columns.isEmpty())
+        return;
+
+    const QVector<int> changedRoles = refreshSourceColumns(first, last, columns);
+    emit this->dataChanged(index(first), index(last), changedRoles);
+}
+
+void QVariantListModel::onSourceRolesAppended()
+{
+    if(!isColumnar())
+        return;
+
+    const QHash<int, int> previousColumns = m_sourceColumns;
+    const int columnCount = m_columns.count();
+    updateSourceColumns();
+    columnsInvalidate(columnCount);
+
+    // The rows were copied before the source had these roles
+    QVector<QPair<int, int>> columns;
+    for (QHash<int, int>::const_iterator it = m_sourceColumns.begin(); it != m_sourceColumns.end(); ++it)
+    {
+        if(!previousColumns.contains(it.key()))
+            columns.append({it.key(), it.value()});
+    }
+
+    const int last = qMin(m_source->rowCount(), m_rows.count()) - 1;
+    if(columns.isEmpty() || last < 0)
+        return;
+
+    const QVector<int> changedRoles = refreshSourceColumns(0, last, columns);
+    emit this->dataChanged(index(0), index(last), changedRoles);
+}
+
+QVector<int> QVariantListModel::refreshSourceColumns(int first, int last, const QVector<QPair<int, int>>& columns)
+{
+    QVector<int> roles;
+    for(const QPair<int, int>& column: columns)
+        roles.append(Qt::UserRole + 1 + column.second);
+
+    for(int i = first; i <= last; ++i)
+    {
+        const QModelIndex modelIndex = m_source->index(i, 0);
+        Row& row = m_rows[i];
+        row.resize(m_columns.count());
+        for(const QPair<int, int>& column: columns)
+            row[column.second] = m_source->data(modelIndex, column.first);
+    }
+    rowsInvalidate();
+
+    return roles;
+}
+
+void QVariantListModel::onSourceLayoutAboutToBeChanged()
+{
+    m_sourceLayout.clear();
+    m_sourceLayout.reserve(m_source->rowCount());
+    for(int i = 0; i < m_source->rowCount(); ++i)
+        m_sourceLayout.append(QPersistentModelIndex(m_source->index(i, 0)));
+}
+
+void QVariantListModel::onSourceLayoutChanged()
+{
+    const QVector<QPersistentModelIndex> layout = std::move(m_sourceLayout);
+    m_sourceLayout.clear();
+
+    QVector<int> positions;
+    positions.reserve(layout.count());
+    for(const QPersistentModelIndex& sourceIndex: layout)
+        positions.append(sourceIndex.row());
+
+    // Rows came and went with the layout change, copy everything again
+    if(layout.count() != m_rows.count() || layout.count() != m_source->rowCount() || positions.contains(-1))
+    {
+        copySource();
+        return;
+    }
+
+    permuteRows(positions);
+}
+
+// ──────── ABSTRACT MODEL PRIVATE ──────────
+void QVariantListModel::countInvalidate()
+{
+    const int aCount = count();
+    bool aEmptyChanged=false;
+
+    if(m_count==aCount)
+        return;
+
+    if((m_count==0 && aCount!=0) || (m_count!=0 && aCount==0))
+        aEmptyChanged=true;
+
+    m_count=aCount;
+    Q_EMIT countChanged(count());
+
+    if(aEmptyChanged)
+        Q_EMIT emptyChanged(isEmpty());
+}
+
+void QVariantListModel::contentInvalidate()
+{
+    if(m_storageChangedQueued)
+        return;
+
+    m_storageChangedQueued = true;
+    QMetaObject::invokeMethod(this, &QVariantListModel::storageInvalidate, Qt::QueuedConnection);
+}
+
+void QVariantListModel::storageInvalidate()
+{
+    m_storageChangedQueued = false;
+
+    // Only pay for the map representation when someone listens to it
+    static const QMetaMethod storageChangedSignal = QMetaMethod::fromSignal(&QVariantListModel::storageChanged);
+    if(isSignalConnected(storageChangedSignal))
+        emit this->storageChanged(storage());
+}
+
+void QVariantListModel::updateRoleNames(const QVariant& var)
+{
+    if(m_roleNames.isEmpty())
+    {
+        m_roleNames[Qt::UserRole] = QByteArrayLiteral("qtVariant");
+
+        // The first item decides whether the rows are split in fields or kept as a whole
+        if(const QVariantMap* firstElement = mapView(var))
+        {
+            m_columnar = true;
+            for (QVariantMap::const_iterator it = firstElement->cbegin(); it != firstElement->cend(); ++it)
+                appendColumn(it.key());
+        }
+    }
+}
+
+int QVariantListModel::appendColumn(const QString& field)
+{
+    const int column = m_columns.count();
+    m_columnIndexes.insert(field, column);
+    m_columns.append(field);
+    m_roleNames.insert(Qt::UserRole + 1 + column, field.toLocal8Bit());
+    return column;
+}
+
+void QVariantListModel::appendFields(const QStringList& fields)
+{
+    if(fields.isEmpty())
+        return;
+
+    if(m_roleNames.isEmpty())
+    {
+        m_roleNames[Qt::UserRole] = QByteArrayLiteral("qtVariant");
+        m_columnar = true;
+    }
+    if(!isColumnar())
+        return;
+
+    const int columnCount = m_columns.count();
+    for(const QString& field: fields)
+    {
+        if(!m_columnIndexes.contains(field))
+            appendColumn(field);
+    }
+    columnsInvalidate(columnCount);
+}
+
+void QVariantListModel::columnsInvalidate(int first)
+{
+    if(first >= m_columns.count())
+        return;
+
+    emit this->rolesAppended(Qt::UserRole + 1 + first, Qt::UserRole + m_columns.count());
+    emit this->fieldsChanged(m_columns);
+}
+
+bool QVariantListModel::diffStorage(const QVariantList& variants)
+{
+    const int keyColumn = m_columnIndexes.value(m_keyField, -1);
+    if(keyColumn < 0)
+        return false;
+
+    const int columnCount = m_columns.count();
+    QVector<Row> rows;
+    rows.reserve(variants.count());
+    for(const QVariant& variant: variants)
+        rows.append(toRow(variant));
+    columnsInvalidate(columnCount);
+
+    // Target index of every key, keys must be unique on both sides
+    QHash<QString, int> targets;
+    targets.reserve(rows.count());
+    for(int i = 0; i < rows.count(); ++i)
+        targets.insert(rows.at(i).value(keyColumn).toString(), i);
+    if(targets.count() != rows.count())
+        return false;
+
+    QVector<int> current(m_rows.count());
+    QVector<bool> inserted(rows.count(), true);
+    QList<int> removed;
+    for(int i = 0; i < m_rows.count(); ++i)
+    {
+        const int target = targets.value(m_rows.at(i).value(keyColumn).toString(), -1);
+        if(target >= 0 && !inserted.at(target))
+            return false;
+
+        current[i] = target;
+        if(target >= 0)
+            inserted[target] = false;
+        else
+            removed.append(i);
+    }
+
+    // 1. Remove the rows whose key is gone, by runs from the end and never through a reset,
+    // whatever removeResetThreshold is
+    if(!removed.isEmpty())
+    {
+        for(int last = removed.count() - 1; last >= 0; )
+        {
+            int first = last;
+            while(first > 0 && removed.at(first - 1) == removed.at(first) - 1)
+                --first;
+
+            const int row = removed.at(first);
+            const int count = last - first + 1;
+            beginRemoveRows(noParent(), row, row + count - 1);
+            rowsRemoveInvalidate(row, count);
+            m_rows.remove(row, count);
+            endRemoveRows();
+
+            last = first - 1;
+        }
+        current.erase(std::remove(current.begin(), current.end(), -1), current.end());
+    }
+
+    // 2. Keep the longest increasing sequence of targets in place and move the others
+    QVector<int> tails;
+    QVector<int> tailIndexes;
+    QVector<int> previous(current.count(), -1);
+    for(int i = 0; i < current.count(); ++i)
+    {
+        const auto it = std::lower_bound(tails.begin(), tails.end(), current.at(i));
+        const int length = int(it - tails.begin());
+        if(it == tails.end())
+        {
+            tails.append(current.at(i));
+            tailIndexes.append(i);
+        }
+        else
+        {
+            *it = current.at(i);
+            tailIndexes[length] = i;
+        }
+        previous[i] = length > 0 ? tailIndexes.at(length - 1) : -1;
+    }
+
+    QVector<bool> anchored(current.count(), false);
+    for(int i = tailIndexes.isEmpty() ? -1 : tailIndexes.last(); i >= 0; i = previous.at(i))
+        anchored[i] = true;
+
+    QVector<int> anchors;
+    QVector<int> movers;
+    for(int i = 0; i < current.count(); ++i)
+    {
+        if(anchored.at(i))
+            anchors.append(current.at(i));
+        else
+            movers.append(current.at(i));
+    }
+
+    // Many moves are cheaper and quieter as a single layout change
+    static const int maxMoves = 16;
+    if(movers.count() > maxMoves && movers.count() * 8 > current.count())
+    {
+        QVector<int> sources(rows.count(), -1);
+        for(int i = 0; i < current.count(); ++i)
+            sources[current.at(i)] = i;
+
+        QVector<int> positions(current.count());
+        int position = 0;
+        for(int source: qAsConst(sources))
+        {
+            if(source >= 0)
+                positions[source] = position++;
+        }
+        permuteRows(positions);
+    }
+    else if(!movers.isEmpty())
+    {
+        std::sort(movers.begin(), movers.end());
+
+        // Current position of every target, kept up to date by the moves
+        QVector<int> positions(rows.count(), -1);
+        for(int i = 0; i < current.count(); ++i)
+            positions[current.at(i)] = i;
+
+        // Movers are placed by ascending target, right after the closest row already in place before them:
+        // the previous mover or the closest anchor
+        int anchor = 0;
+        int closest = -1;
+        for(int target: qAsConst(movers))
+        {
+            while(anchor < anchors.count() && anchors.at(anchor) < target)
+                closest = qMax(closest, anchors.at(anchor++));
+
+            const int from = positions.at(target);
+            const int to = closest < 0 ? 0 : positions.at(closest) + 1;
+            closest = target;
+
+            if(to == from || to == from + 1)
+                continue;
+
+            moveRows(noParent(), from, 1, noParent(), to);
+            const int destination = to > from ? to - 1 : to;
+            current.move(from, destination);
+            for(int i = qMin(from, destination); i <= qMax(from, destination); ++i)
+                positions[current.at(i)] = i;
+        }
+    }
+
+    // 3. Insert the new rows, by runs of contiguous targets
+    for(int first = 0; first < rows.count(); ++first)
+    {
+        if(!inserted.at(first))
+            continue;
+
+        int last = first;
+        while(last + 1 < rows.count() && inserted.at(last + 1))
+            ++last;
+
+        beginInsertRows(noParent(), first, last);
+        m_rows.insert(first, rows.mid(first, last - first + 1));
+        rowsInsertInvalidate(first, last - first + 1);
+        endInsertRows();
+
+        first = last;
+    }
+
+    // 4. Update the values that changed in the rows that were kept
+    for(int i = 0; i < rows.count(); ++i)
+    {
+        if(!inserted.at(i))
+            updateRow(i, rows.at(i));
+    }
+
+    return true;
+}
+
+bool QVariantListModel::diffStorageByPosition(const QVariantList& variants)
+{
+    const int columnCount = m_columns.count();
+    QVector<Row> rows;
+    rows.reserve(variants.count());
+    for(const QVariant& variant: variants)
+        rows.append(toRow(variant));
+    columnsInvalidate(columnCount);
+
+    // Rows at the same position are updated, the extra rows are removed or inserted at the end
+    const int common = qMin(m_rows.count(), rows.count());
+    if(m_rows.count() > common)
+        remove(common, m_rows.count() - common);
+
+    for(int i = 0; i < common; ++i)
+        updateRow(i, rows.at(i));
+
+    if(rows.count() > common)
+    {
+        beginInsertRows(noParent(), common, rows.count() - 1);
+        m_rows.insert(common, rows.mid(common));
+        rowsInsertInvalidate(common, rows.count() - common);
+        endInsertRows();
+    }
+
+    return true;
+}
+
+void QVariantListModel::updateRow(int i, const Row& row)
+{
+    // Compared first so that unchanged rows don't detach their chunk
+    const Row& current = m_rows.at(i);
+    const int columnCount = qMax(current.count(), row.count());
+    QVector<int> columns;
+    for(int column = 0; column < columnCount; ++column)
+    {
+        if(current.value(column) != row.value(column))
+            columns.append(column);
+    }
+
+    if(columns.isEmpty())
+        return;
+
+    Row& original = m_rows[i];
+    original.resize(columnCount);
+
+    QVector<int> roles;
+    for(int column: qAsConst(columns))
+    {
+        const QVariant before = original.at(column);
+        original[column] = row.value(column);
+        cellInvalidate(i, column, before);
+        roles.append(isColumnar() ? Qt::UserRole + 1 + column : Qt::UserRole);
+    }
+
+    emit this->dataChanged(index(i), index(i), roles);
+}
+
+bool QVariantListModel::resetRows(const QStringList& fields, bool columnar, const QVector<Row>& rows)
+{
+    // Nothing loaded: clear the rows and leave the schema to the next items, as setStorage() does
+    const bool empty = rows.isEmpty() && fields.isEmpty();
+
+    if(!empty && !m_roleNames.isEmpty() && columnar != isColumnar())
+    {
+        QMODELSLOG_WARNING() << "cannot load rows with" << (columnar ? "fields in a model without" : "no fields in a model with") << "fields";
+        return false;
+    }
+
+    const int columnCount = m_columns.count();
+
+    beginResetModel();
+    m_rows.clear();
+    clearStringPool();
+
+    if(!empty && m_roleNames.isEmpty())
+    {
+        m_roleNames[Qt::UserRole] = QByteArrayLiteral("qtVariant");
+        m_columnar = columnar;
+    }
+
+    // Position in the model of every field of the rows
+    QVector<int> columns;
+    bool sameColumns = true;
+    for(int i = 0; i < fields.count(); ++i)
+    {
+        int column = m_columnIndexes.value(fields.at(i), -1);
+        if(column < 0)
+            column = appendColumn(fields.at(i));
+        columns.append(column);
+        sameColumns = sameColumns && column == i;
+    }
+
+    for(const Row& row: rows)
+    {
+        if(sameColumns && !m_internStrings)
+        {
+            m_rows.append(row);
+            continue;
+        }
+
+        Row mapped = sameColumns ? row : Row(m_columns.count());
+        for(int i = 0; i < row.count(); ++i)
+        {
+            QVariant& value = mapped[sameColumns ? i : columns.at(i)];
+            if(!sameColumns)
+                value = row.at(i);
+            internString(value);
+        }
+        m_rows.append(mapped);
+    }
+    rowsInvalidate();
+
+    endResetModel();
+
+    columnsInvalidate(columnCount);
+
+    return true;
+}
+
+void QVariantListModel::rowsInvalidate()
+{
+    m_storageDirty = true;
+    ++m_version;
+
+    for(QVariantListFieldIndex& fieldIndex: m_fieldIndexes)
+        fieldIndex.invalidate();
+}
+
+void QVariantListModel::rowsInsertInvalidate(int first, int count)
+{
+    m_storageDirty = true;
+    ++m_version;
+
+    for(auto it = m_fieldIndexes.begin(); it != m_fieldIndexes.end(); ++it)
+        it->insertRows(m_rows, m_columnIndexes.value(it.key(), -1), first, count);
+}
+
+void QVariantListModel::rowsRemoveInvalidate(int first, int count)
+{
+    // Called before the rows are removed, the indexes look their values up
+    m_storageDirty = true;
+    ++m_version;
+
+    for(auto it = m_fieldIndexes.begin(); it != m_fieldIndexes.end(); ++it)
+        it->removeRows(m_rows, m_columnIndexes.value(it.key(), -1), first, count);
+}
+
+void QVariantListModel::cellInvalidate(int row, int column, const QVariant& before)
+{
+    m_storageDirty = true;
+    ++m_version;
+
+    if(column < 0 || column >= m_columns.count())
+        return;
+
+    auto it = m_fieldIndexes.find(m_columns.at(column));
+    if(it != m_fieldIndexes.end())
+        it->update(row, before, m_rows.at(row).value(column));
+}
+
+void QVariantListModel::updateFieldIndexes()
+{
+    m_fieldIndexes.clear();
+    for(const QString& field: qAsConst(m_hashedFields))
+        m_fieldIndexes.insert(field, QVariantListFieldIndex(QVariantListFieldIndex::Hash));
+    // An ordered index also answers equality lookups
+    for(const QString& field: qAsConst(m_orderedFields))
+        m_fieldIndexes.insert(field, QVariantListFieldIndex(QVariantListFieldIndex::Ordered));
+}
+
+const QVariantListFieldIndex* QVariantListModel::fieldIndex(int column) const
+{
+    if(column < 0 || column >= m_columns.count())
+        return nullptr;
+
+    auto it = m_fieldIndexes.find(m_columns.at(column));
+    if(it == m_fieldIndexes.end())
+        return nullptr;
+
+    if(!it->isValid())
+        it->build(m_rows, column);
+
+    return &it.value();
+}
+
+void QVariantListModel::permuteRows(const QVector<int>& positions, QAbstractItemModel::LayoutChangeHint hint)
+{
+    emit this->layoutAboutToBeChanged(QList<QPersistentModelIndex>(), hint);
+
+    QVector<Row> rows(m_rows.count());
+    for(int i = 0; i < positions.count(); ++i)
+        rows[positions.at(i)] = m_rows.at(i);
+    m_rows.clear();
+    m_rows.insert(0, rows);
+    rowsInvalidate();
+
+    const QModelIndexList from = persistentIndexList();
+    QModelIndexList to;
+    to.reserve(from.count());
+    for(const QModelIndex& modelIndex: from)
+        to.append(index(positions.value(modelIndex.row(), modelIndex.row()), modelIndex.column()));
+    changePersistentIndexList(from, to);
+
+    emit this->layoutChanged(QList<QPersistentModelIndex>(), hint);
+}
+
+bool QVariantListModel::acceptsItem(const QVariant& variant, bool columnar)
+{
+    if(columnar && !mapView(variant))
+    {
+        QMODELSLOG_WARNING() << "cannot store a non map item in a model with fields:" << variant;
+        return false;
+    }
+    return true;
+}
+
+QVariantListModel::Row QVariantListModel::toRow(const QVariant& variant)
+{
+    updateRoleNames(variant);
+
+    if(!isColumnar())
+    {
+        Row row{variant};
+        internString(row[0]);
+        return row;
+    }
+
+    Row row(m_columns.count());
+    const QVariantMap* map = mapView(variant);
+    if(!map)
+    {
+        QMODELSLOG_WARNING() << "cannot store a non map item in a model with fields:" << variant;
+        return row;
+    }
+
+    // Unknown keys extend the schema in the same pass
+    for (QVariantMap::const_iterator it = map->cbegin(); it != map->cend(); ++it)
+    {
+        int column = m_columnIndexes.value(it.key(), -1);
+        if(column < 0)
+        {
+            column = appendColumn(it.key());
+            row.resize(m_columns.count());
+        }
+        row[column] = it.value();
+        internString(row[column]);
+    }
+
+    return row;
+}
+
+void QVariantListModel::internString(QVariant& value)
+{
+    // Long strings seldom repeat, don't pay a hash lookup for them
+    static const int maxLength = 64;
+    static const int maxPoolSize = 1 << 16;
+
+    if(!m_internStrings || value.userType() != QMetaType::QString)
+        return;
+
+    const QString* string = static_cast<const QString*>(value.constData());
+    if(string->isEmpty() || string->size() > maxLength)
+        return;
+
+    const QSet<QString>::const_iterator it = m_stringPool.constFind(*string);
+    if(it == m_stringPool.constEnd())
+    {
+        // Removed rows and diffs leave strings nobody uses, a full pool only keeps the ones the rows hold
+        if(m_stringPool.size() >= maxPoolSize)
+            pruneStringPool(maxLength, maxPoolSize / 2);
+        if(m_stringPool.size() < maxPoolSize)
+            m_stringPool.insert(*string);
+        return;
+    }
+
+    if(it->constData() != string->constData())
+    {
+        m_internedBytes += qint64(sizeof(QString::Data)) + string->size() * qint64(sizeof(QChar));
+        value = QVariant(*it);
+    }
+}
+
+void QVariantListModel::pruneStringPool(int maxLength, int maxSize)
+{
+    QSet<QString> pool;
+    for(int i = 0; i < m_rows.count() && pool.size() < maxSize; ++i)
+    {
+        for(const QVariant& value: m_rows.at(i))
+        {
+            if(value.userType() != QMetaType::QString)
+                continue;
+
+            const QString* string = static_cast<const QString*>(value.constData());
+            if(!string->isEmpty() && string->size() <= maxLength)
+                pool.insert(*string);
+        }
+    }
+    m_stringPool = pool;
+}
+
+void QVariantListModel::clearStringPool()
+{
+    m_stringPool.clear();
+    m_internedBytes = 0;
+}
+
+QVariant QVariantListModel::fromRow(const Row& row) const
+{
+    if(!isColumnar())
+        return row.value(0);
+
+    QVariantMap map;
+    for(int column=0; column<row.count(); ++column)
+    {
+        const QVariant& value = row.at(column);
+        if(value.isValid())
+            map.insert(m_columns.at(column), value);
     }
+    return map;
 }
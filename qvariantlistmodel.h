@@ -5,11 +5,21 @@
 #include <QVariant>
 #include <QHash>
 #include <QList>
+#include <QVector>
+#include <QSet>
 #include <QAbstractListModel>
+#include <QPointer>
 #include <QQmlParserStatus>
 #include <QtQml>
 #include <QDebug>
 
+#include <functional>
+
+#include "qvariantlistfieldindex.h"
+#include "qvariantlistrows.h"
+#include "qvariantlistsnapshot.h"
+#include "qvariantlistsorter.h"
+
 class QVariantListModel: public QAbstractListModel,
                          public QQmlParserStatus
 {
@@ -23,13 +33,45 @@ class QVariantListModel: public QAbstractListModel,
 
     Q_PROPERTY(QStringList fields READ fields WRITE setFields NOTIFY fieldsChanged)
     Q_PROPERTY(QVariantList storage READ storage WRITE setStorage NOTIFY storageChanged)
+    Q_PROPERTY(QStringList hashedFields READ hashedFields WRITE setHashedFields NOTIFY hashedFieldsChanged)
+    Q_PROPERTY(QStringList orderedFields READ orderedFields WRITE setOrderedFields NOTIFY orderedFieldsChanged)
+    Q_PROPERTY(StorageLayout storageLayout READ storageLayout WRITE setStorageLayout NOTIFY storageLayoutChanged)
+    Q_PROPERTY(bool internStrings READ internStrings WRITE setInternStrings NOTIFY internStringsChanged)
+    Q_PROPERTY(bool live READ live WRITE setLive NOTIFY liveChanged)
+    Q_PROPERTY(QString keyField READ keyField WRITE setKeyField NOTIFY keyFieldChanged)
+    Q_PROPERTY(int removeResetThreshold READ removeResetThreshold WRITE setRemoveResetThreshold NOTIFY removeResetThresholdChanged)
 
     // ──────── CONSTRUCTOR ──────────
 public:
     explicit QVariantListModel(QObject * parent = nullptr);
+    ~QVariantListModel() override;
+
+    // A row holds one value per field, at index (role - Qt::UserRole - 1).
+    // When the model has no fields, a row holds the raw variant at index 0.
+    using Row = QVariantListRows::Row;
+
+    enum StorageChange {
+        DataChange,
+        InsertChange,
+        RemoveChange,
+        ResetChange
+    };
+    Q_ENUM (StorageChange)
+
+    enum StorageLayout {
+        // Fastest index access, for lists mostly appended to
+        PackedLayout = QVariantListRows::PackedLayout,
+        // Cheap inserts and removes anywhere, for lists edited in the middle or prepended to
+        BalancedLayout = QVariantListRows::BalancedLayout
+    };
+    Q_ENUM (StorageLayout)
 
     static const QModelIndex& noParent();
 
+    // Read-only access to the map held by a variant, without copying it.
+    // Returns nullptr when the variant doesn't hold a QVariantMap.
+    static const QVariantMap* mapView(const QVariant& variant);
+
     // ──────── ABSTRACT MODEL OVERRIDE ──────────
 public:
     QVariant data(const QModelIndex& modelIndex, int role) const override final;
@@ -37,6 +79,10 @@ public:
 
     QHash<int, QByteArray> roleNames() const override final;
     int rowCount(const QModelIndex& parent = QModelIndex()) const override final;
+    bool moveRows(const QModelIndex& sourceParent, int sourceRow, int count, const QModelIndex& destinationParent, int destinationChild) override final;
+    bool removeRows(int row, int count, const QModelIndex& parent = QModelIndex()) override final;
+    QModelIndexList match(const QModelIndex& start, int role, const QVariant& value, int hits = 1,
+                          Qt::MatchFlags flags = Qt::MatchFlags(Qt::MatchStartsWith|Qt::MatchWrap)) const override;
 
     // ──────── PUBLIC API ──────────
 public:
@@ -63,11 +109,54 @@ public:
     Q_INVOKABLE bool move(int from, int to, int count = 1);
     Q_INVOKABLE bool remove(int index, int count=1);
     Q_INVOKABLE bool remove(QList<int> indexes);
+    Q_INVOKABLE int removeIf(const QJSValue& predicate);
+    int removeIf(const std::function<bool(const QVariant&)>& predicate);
     Q_INVOKABLE bool clear();
 
+    using QAbstractListModel::sort;
+    Q_INVOKABLE bool sort(const QString& field, Qt::SortOrder order = Qt::AscendingOrder);
+    Q_INVOKABLE bool sortBy(const QStringList& fields, const QList<int>& orders = QList<int>());
+
     const QVariantList& storage() const;
     bool setStorage(const QVariant& storage);
 
+    // Cheap immutable copy of the rows, safe to read from another thread
+    QVariantListSnapshot snapshot() const;
+    // Incremented by every change of the rows
+    quint64 version() const;
+
+    // Compact binary copy of the rows, see QVariantListBinary
+    Q_INVOKABLE bool saveBinary(const QString& path) const;
+    Q_INVOKABLE bool loadBinary(const QString& path);
+
+    const QStringList& hashedFields() const;
+    bool setHashedFields(const QStringList& fields);
+    const QStringList& orderedFields() const;
+    bool setOrderedFields(const QStringList& fields);
+
+    bool isIndexed(int role) const;
+    int indexOf(int role, const QVariant& value) const;
+    QList<int> indexesOf(int role, const QVariant& value) const;
+    Q_INVOKABLE int indexOf(const QString& field, const QVariant& value) const;
+    Q_INVOKABLE QList<int> indexesOf(const QString& field, const QVariant& value) const;
+    Q_INVOKABLE QList<int> indexesInRange(const QString& field, const QVariant& from, const QVariant& to) const;
+
+    StorageLayout storageLayout() const;
+    bool setStorageLayout(StorageLayout layout);
+
+    bool internStrings() const;
+    bool setInternStrings(bool internStrings);
+    Q_INVOKABLE qint64 internedBytes() const;
+
+    bool live() const;
+    bool setLive(bool live);
+
+    const QString& keyField() const;
+    bool setKeyField(const QString& keyField);
+
+    int removeResetThreshold() const;
+    bool setRemoveResetThreshold(int threshold);
+
 public slots:
     bool setSource(QAbstractItemModel* model);
 
@@ -75,40 +164,137 @@ signals:
     void countChanged(int count);
     void emptyChanged(bool empty);
     void fieldsChanged(const QStringList& value);
+    // New fields were discovered in inserted items, roles first to last were appended
+    void rolesAppended(int first, int last);
+    // Coalesced, emitted at most once per event loop iteration
     void storageChanged(const QVariantList& storage);
+    void hashedFieldsChanged(const QStringList& fields);
+    void orderedFieldsChanged(const QStringList& fields);
+    void storageLayoutChanged(QVariantListModel::StorageLayout layout);
+    void internStringsChanged(bool internStrings);
+    void liveChanged(bool live);
+    void keyFieldChanged(const QString& keyField);
+    void removeResetThresholdChanged(int threshold);
+    // Emitted synchronously for each edit, with the affected rows and roles (empty for all roles)
+    void storageUpdated(QVariantListModel::StorageChange change, int first, int last, const QVector<int>& roles);
 
     // ──────── ABSTRACT MODEL PRIVATE ──────────
 protected:
     void countInvalidate();
     void contentInvalidate();
+    void storageInvalidate();
     void updateRoleNames(const QVariant& var);
 
+    bool isColumnar() const { return m_columnar; }
+    // The fields were set before any item was inserted, loaders may skip the other fields
+    bool hasDeclaredFields() const { return m_fieldsDeclared; }
+    int appendColumn(const QString& field);
+    // Appends the fields missing from the model in their order, before items holding them are stored
+    void appendFields(const QStringList& fields);
+    void columnsInvalidate(int first);
+    // A model with fields only stores maps
+    static bool acceptsItem(const QVariant& variant, bool columnar);
+    Row toRow(const QVariant& variant);
+    void internString(QVariant& value);
+    void pruneStringPool(int maxLength, int maxSize);
+    void clearStringPool();
+    QVariant fromRow(const Row& row) const;
+
+    void rowsInvalidate();
+    void rowsInsertInvalidate(int first, int count);
+    void rowsRemoveInvalidate(int first, int count);
+    void cellInvalidate(int row, int column, const QVariant& before);
+    void updateFieldIndexes();
+    const QVariantListFieldIndex* fieldIndex(int column) const;
+
+    bool diffStorage(const QVariantList& variants);
+    bool diffStorageByPosition(const QVariantList& variants);
+    void updateRow(int i, const Row& row);
+    bool resetRows(const QStringList& fields, bool columnar, const QVector<Row>& rows);
+    void permuteRows(const QVector<int>& positions, QAbstractItemModel::LayoutChangeHint hint = QAbstractItemModel::NoLayoutChangeHint);
+
+    // ──────── SOURCE MIRRORING ──────────
+private:
+    bool copySource();
+    void connectSource();
+    void updateSourceColumns();
+    QVariantMap sourceMap(int row) const;
+    // The item of a QVariantListModel source, the map of its roles otherwise
+    QVariant sourceItem(int row) const;
+    bool isSourceRole(int role, const QByteArray& name) const;
+    Row sourceRow(int row);
+    // Reads again the given (role, column) pairs of the rows from first to last
+    QVector<int> refreshSourceColumns(int first, int last, const QVector<QPair<int, int>>& columns);
+
+    void onSourceRowsInserted(const QModelIndex& parent, int first, int last);
+    void onSourceRowsRemoved(const QModelIndex& parent, int first, int last);
+    void onSourceRowsMoved(const QModelIndex& parent, int start, int end, const QModelIndex& destination, int row);
+    void onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles);
+    void onSourceRolesAppended();
+    void onSourceLayoutAboutToBeChanged();
+    void onSourceLayoutChanged();
+
     // ──────── ITERATOR ──────────
 public:
     using const_iterator = typename QVariantList::const_iterator;
-    const_iterator begin() const { return m_storage.begin(); }
-    const_iterator end() const { return m_storage.end(); }
-    const_iterator cbegin() const { return m_storage.begin(); }
-    const_iterator cend() const { return m_storage.end(); }
-    const_iterator constBegin() const { return m_storage.constBegin(); }
-    const_iterator constEnd() const { return m_storage.constEnd(); }
+    const_iterator begin() const { return storage().begin(); }
+    const_iterator end() const { return storage().end(); }
+    const_iterator cbegin() const { return storage().begin(); }
+    const_iterator cend() const { return storage().end(); }
+    const_iterator constBegin() const { return storage().constBegin(); }
+    const_iterator constEnd() const { return storage().constEnd(); }
 
     using const_reverse_iterator = typename QVariantList::const_reverse_iterator;
-    const_reverse_iterator rbegin() const { return m_storage.rbegin(); }
-    const_reverse_iterator rend() const { return m_storage.rend(); }
-    const_reverse_iterator crbegin() const { return m_storage.crbegin(); }
-    const_reverse_iterator crend() const { return m_storage.crend(); }
+    const_reverse_iterator rbegin() const { return storage().rbegin(); }
+    const_reverse_iterator rend() const { return storage().rend(); }
+    const_reverse_iterator crbegin() const { return storage().crbegin(); }
+    const_reverse_iterator crend() const { return storage().crend(); }
 
     // ──────── ATTRIBUTES ──────────
 protected:
     bool m_canWrite;
 
 private:
-    QStringList m_fields;
-    QVariantList m_storage;
+    QVariantListRows m_rows;
+    quint64 m_version=0;
+
+    // Union of the fields of every item, in discovery order
+    bool m_columnar=false;
+    bool m_fieldsDeclared=false;
+    QStringList m_columns;
+    QHash<QString, int> m_columnIndexes;
+
+    // Map representation of m_rows, only built when storage() is read
+    mutable QVariantList m_storage;
+    mutable bool m_storageDirty=false;
+    bool m_storageChangedQueued=false;
+
+    // Repeated short strings of the rows share one copy
+    bool m_internStrings=true;
+    QSet<QString> m_stringPool;
+    qint64 m_internedBytes=0;
+
+    // Secondary indexes by field name
+    QStringList m_hashedFields;
+    QStringList m_orderedFields;
+    mutable QHash<QString, QVariantListFieldIndex> m_fieldIndexes;
+
+    // When set, setStorage() updates the rows matching by this field instead of resetting
+    QString m_keyField;
+
+    // Source copied by setSource(), kept in sync while live
+    QPointer<QAbstractItemModel> m_source;
+    bool m_live=false;
+    QHash<int, int> m_sourceColumns;
+    QVector<QPersistentModelIndex> m_sourceLayout;
+
+    // Above this number of separate row runs, remove(QList<int>) resets the model
+    int m_removeResetThreshold=64;
 
     int m_count=0;
     QHash<int, QByteArray> m_roleNames;
 };
 
+Q_DECLARE_METATYPE (QVariantListModel::StorageChange)
+
 #endif // QVARIANTLISTMODEL_H
@@ -0,0 +1,307 @@
+#include "qvariantlistrows.h"
+
+#include <algorithm>
+
+void QVariantListRows::setLayout(Layout layout)
+{
+    if(m_layout == layout)
+        return;
+
+    const QVector<Row> rows = mid(0);
+    m_layout = layout;
+    rechunk(0, rows);
+}
+
+const QVariantListRows::Row& QVariantListRows::at(int i) const
+{
+    const int chunk = chunkOf(i);
+    return m_chunks.at(chunk)->rows.at(i - m_offsets.at(chunk));
+}
+
+QVariantListRows::Row& QVariantListRows::operator[](int i)
+{
+    const int chunk = chunkOf(i);
+    return m_chunks[chunk]->rows[i - m_offsets.at(chunk)];
+}
+
+void QVariantListRows::append(const Row& row)
+{
+    if(m_chunks.isEmpty() || m_chunks.constLast()->rows.count() >= ChunkSize)
+    {
+        Chunk* chunk = new Chunk;
+        chunk->rows.reserve(ChunkSize);
+        m_chunks.append(QSharedDataPointer<Chunk>(chunk));
+        m_offsets.append(m_count);
+    }
+    m_chunks.last()->rows.append(row);
+    ++m_count;
+}
+
+void QVariantListRows::insert(int i, const Row& row)
+{
+    insert(i, QVector<Row>{row});
+}
+
+void QVariantListRows::insert(int i, const QVector<Row>& rows)
+{
+    if(rows.isEmpty())
+        return;
+
+    if(i >= m_count)
+    {
+        for(const Row& row: rows)
+            append(row);
+        return;
+    }
+
+    if(m_layout == PackedLayout && rows.count() <= ChunkSize)
+    {
+        // Every chunk but the last one stays full: each chunk after the insertion point
+        // passes its last rows on to the next one
+        int chunk = chunkOf(i);
+        int offset = i - m_offsets.at(chunk);
+        QVector<Row> carry = rows;
+        while(!carry.isEmpty())
+        {
+            if(chunk == m_chunks.count())
+            {
+                Chunk* data = new Chunk;
+                data->rows.reserve(ChunkSize);
+                m_chunks.append(QSharedDataPointer<Chunk>(data));
+            }
+
+            QVector<Row>& target = m_chunks[chunk]->rows;
+            target.insert(offset, carry.count(), Row());
+            std::copy(carry.cbegin(), carry.cend(), target.begin() + offset);
+            if(target.count() > ChunkSize)
+            {
+                carry = target.mid(ChunkSize);
+                target.resize(ChunkSize);
+            }
+            else
+            {
+                carry.clear();
+            }
+            ++chunk;
+            offset = 0;
+        }
+        updateOffsets(chunkOf(i));
+        return;
+    }
+
+    if(m_layout == PackedLayout)
+    {
+        // Large inserts rebuild the chunks after the insertion point at once
+        const int firstChunk = chunkOf(i);
+        const QVector<Row> tail = mid(m_offsets.at(firstChunk));
+        const int offset = i - m_offsets.at(firstChunk);
+
+        QVector<Row> merged;
+        merged.reserve(tail.count() + rows.count());
+        merged += tail.mid(0, offset);
+        merged += rows;
+        merged += tail.mid(offset);
+        rechunk(firstChunk, merged);
+        return;
+    }
+
+    // Only the chunk holding the insertion point grows, it is split when it gets too large
+    const int chunk = chunkOf(i);
+    const int offset = i - m_offsets.at(chunk);
+    if(m_chunks.at(chunk)->rows.count() + rows.count() <= 2 * ChunkSize)
+    {
+        QVector<Row>& target = m_chunks[chunk]->rows;
+        target.insert(offset, rows.count(), Row());
+        std::copy(rows.cbegin(), rows.cend(), target.begin() + offset);
+    }
+    else
+    {
+        const QVector<Row>& current = m_chunks.at(chunk)->rows;
+        QVector<Row> merged;
+        merged.reserve(current.count() + rows.count());
+        merged += current.mid(0, offset);
+        merged += rows;
+        merged += current.mid(offset);
+
+        QVector<QSharedDataPointer<Chunk>> chunks = m_chunks.mid(0, chunk);
+        for(int first = 0; first < merged.count(); first += ChunkSize)
+        {
+            Chunk* data = new Chunk;
+            data->rows = merged.mid(first, ChunkSize);
+            chunks.append(QSharedDataPointer<Chunk>(data));
+        }
+        chunks += m_chunks.mid(chunk + 1);
+        m_chunks = chunks;
+    }
+    updateOffsets(chunk);
+}
+
+void QVariantListRows::remove(int i, int count)
+{
+    if(count <= 0)
+        return;
+
+    if(m_layout == PackedLayout && count <= ChunkSize)
+    {
+        // The removed rows span at most two chunks, then every chunk is filled up
+        // again with the first rows of the next one
+        const int firstChunk = chunkOf(i);
+        const int offset = i - m_offsets.at(firstChunk);
+        QVector<Row>& target = m_chunks[firstChunk]->rows;
+        const int removed = qMin(count, target.count() - offset);
+        target.remove(offset, removed);
+        if(count > removed && firstChunk + 1 < m_chunks.count())
+            m_chunks[firstChunk + 1]->rows.remove(0, count - removed);
+
+        for(int chunk = firstChunk; chunk + 1 < m_chunks.count(); ++chunk)
+        {
+            const int missing = ChunkSize - m_chunks.at(chunk)->rows.count();
+            if(missing <= 0)
+                break;
+
+            const int moved = qMin(missing, m_chunks.at(chunk + 1)->rows.count());
+            m_chunks[chunk]->rows += m_chunks.at(chunk + 1)->rows.mid(0, moved);
+            m_chunks[chunk + 1]->rows.remove(0, moved);
+        }
+        while(!m_chunks.isEmpty() && m_chunks.constLast()->rows.isEmpty())
+            m_chunks.removeLast();
+        updateOffsets(firstChunk);
+        return;
+    }
+
+    if(m_layout == PackedLayout)
+    {
+        const int firstChunk = chunkOf(i);
+        QVector<Row> tail = mid(m_offsets.at(firstChunk));
+        tail.remove(i - m_offsets.at(firstChunk), count);
+        rechunk(firstChunk, tail);
+        return;
+    }
+
+    // Chunks removed as a whole are dropped without being copied
+    const int firstChunk = chunkOf(i);
+    int chunk = firstChunk;
+    int offset = i - m_offsets.at(chunk);
+    int remaining = count;
+    while(remaining > 0 && chunk < m_chunks.count())
+    {
+        const int size = m_chunks.at(chunk)->rows.count();
+        const int removed = qMin(remaining, size - offset);
+        if(removed == size)
+        {
+            m_chunks.remove(chunk);
+        }
+        else
+        {
+            m_chunks[chunk]->rows.remove(offset, removed);
+            ++chunk;
+        }
+        remaining -= removed;
+        offset = 0;
+    }
+
+    merge(firstChunk);
+    merge(firstChunk - 1);
+    updateOffsets(firstChunk - 1);
+}
+
+void QVariantListRows::move(int from, int count, int destinationChild)
+{
+    const int first = qMin(from, destinationChild);
+    const int last = qMax(from + count, destinationChild);
+    if(count <= 0 || last - first <= count)
+        return;
+
+    if(m_layout == BalancedLayout)
+    {
+        const QVector<Row> rows = mid(from, count);
+        remove(from, count);
+        insert(destinationChild > from ? destinationChild - count : destinationChild, rows);
+        return;
+    }
+
+    // Only the chunks spanned by the move are rebuilt, their sizes don't change
+    const int firstChunk = chunkOf(first);
+    const int lastChunk = chunkOf(last - 1);
+    const int base = m_offsets.at(firstChunk);
+    QVector<Row> rows = mid(base, (lastChunk - firstChunk + 1) * ChunkSize);
+
+    const auto begin = rows.begin();
+    if(destinationChild > from)
+        std::rotate(begin + (from - base), begin + (from + count - base), begin + (destinationChild - base));
+    else
+        std::rotate(begin + (destinationChild - base), begin + (from - base), begin + (from + count - base));
+
+    for(int chunk = firstChunk; chunk <= lastChunk; ++chunk)
+    {
+        Chunk* data = new Chunk;
+        data->rows = rows.mid((chunk - firstChunk) * ChunkSize, ChunkSize);
+        m_chunks[chunk] = QSharedDataPointer<Chunk>(data);
+    }
+}
+
+void QVariantListRows::clear()
+{
+    m_chunks.clear();
+    m_offsets.clear();
+    m_count = 0;
+}
+
+QVector<QVariantListRows::Row> QVariantListRows::mid(int i, int count) const
+{
+    const int last = (count < 0 || i + count > m_count) ? m_count : i + count;
+
+    QVector<Row> ret;
+    if(i >= last)
+        return ret;
+
+    ret.reserve(last - i);
+    for(int chunk = chunkOf(i); chunk < m_chunks.count() && m_offsets.at(chunk) < last; ++chunk)
+    {
+        const QVector<Row>& rows = m_chunks.at(chunk)->rows;
+        const int begin = qMax(i - m_offsets.at(chunk), 0);
+        const int end = qMin(last - m_offsets.at(chunk), rows.count());
+        for(int row = begin; row < end; ++row)
+            ret.append(rows.at(row));
+    }
+    return ret;
+}
+
+int QVariantListRows::chunkOf(int i) const
+{
+    if(m_layout == PackedLayout)
+        return i / ChunkSize;
+    return int(std::upper_bound(m_offsets.cbegin(), m_offsets.cend(), i) - m_offsets.cbegin()) - 1;
+}
+
+void QVariantListRows::rechunk(int firstChunk, const QVector<Row>& rows)
+{
+    m_chunks.resize(firstChunk);
+    for(int i = 0; i < rows.count(); i += ChunkSize)
+    {
+        Chunk* chunk = new Chunk;
+        chunk->rows = rows.mid(i, ChunkSize);
+        m_chunks.append(QSharedDataPointer<Chunk>(chunk));
+    }
+    updateOffsets(firstChunk);
+}
+
+void QVariantListRows::merge(int chunk)
+{
+    if(chunk < 0 || chunk + 1 >= m_chunks.count())
+        return;
+
+    if(m_chunks.at(chunk)->rows.count() + m_chunks.at(chunk + 1)->rows.count() > ChunkSize)
+        return;
+
+    m_chunks[chunk]->rows += m_chunks.at(chunk + 1)->rows;
+    m_chunks.remove(chunk + 1);
+}
+
+void QVariantListRows::updateOffsets(int firstChunk)
+{
+    m_offsets.resize(m_chunks.count());
+    for(int chunk = qMax(firstChunk, 0); chunk < m_chunks.count(); ++chunk)
+        m_offsets[chunk] = (chunk == 0) ? 0 : m_offsets.at(chunk - 1) + m_chunks.at(chunk - 1)->rows.count();
+    m_count = m_chunks.isEmpty() ? 0 : m_offsets.constLast() + m_chunks.constLast()->rows.count();
+}
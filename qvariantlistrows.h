@@ -0,0 +1,73 @@
+#ifndef QVARIANTLISTROWS_H
+#define QVARIANTLISTROWS_H
+
+#include <QSharedData>
+#include <QSharedDataPointer>
+#include <QVariant>
+#include <QVector>
+
+// Row storage of a QVariantListModel, split in implicitly shared chunks.
+// Copying it only copies the chunk pointers, and a write only detaches the chunk it touches,
+// so a copy handed to another thread costs O(n / ChunkSize) and stays valid while the original changes.
+class QVariantListRows
+{
+public:
+    using Row = QVector<QVariant>;
+
+    static const int ChunkSize = 1024;
+
+    enum Layout {
+        // Every chunk but the last one is full: index access is a division,
+        // inserting or removing shifts rows through the chunks after the edited row
+        PackedLayout,
+        // Chunks hold between a few and 2 * ChunkSize rows: index access is a binary search on the chunk offsets,
+        // inserting or removing only rebuilds the edited chunk and updates the offsets
+        BalancedLayout
+    };
+
+    explicit QVariantListRows(Layout layout = PackedLayout) : m_layout(layout) {}
+
+    Layout layout() const { return m_layout; }
+    // Rebuilds the chunks, the rows are left untouched
+    void setLayout(Layout layout);
+
+    int count() const { return m_count; }
+    int size() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+
+    const Row& at(int i) const;
+    const Row& operator[](int i) const { return at(i); }
+    // Detaches the chunk holding the row, the others stay shared
+    Row& operator[](int i);
+    void replace(int i, const Row& row) { (*this)[i] = row; }
+
+    void append(const Row& row);
+    void insert(int i, const Row& row);
+    void insert(int i, const QVector<Row>& rows);
+    void remove(int i, int count = 1);
+    // Same semantics as QAbstractItemModel::moveRows()
+    void move(int from, int count, int destinationChild);
+    void clear();
+
+    QVector<Row> mid(int i, int count = -1) const;
+
+private:
+    struct Chunk: public QSharedData {
+        QVector<Row> rows;
+    };
+
+    int chunkOf(int i) const;
+    // Replaces the chunks from firstChunk to the end with rows
+    void rechunk(int firstChunk, const QVector<Row>& rows);
+    // Merges a chunk with the next one when they fit in a single chunk
+    void merge(int chunk);
+    void updateOffsets(int firstChunk);
+
+    Layout m_layout;
+    QVector<QSharedDataPointer<Chunk>> m_chunks;
+    // Index of the first row of every chunk
+    QVector<int> m_offsets;
+    int m_count=0;
+};
+
+#endif // QVARIANTLISTROWS_H
@@ -0,0 +1,48 @@
+#include "qvariantlistsnapshot.h"
+
+QVariantListSnapshot::QVariantListSnapshot(const QVariantListRows& rows, const QStringList& columns, bool columnar, quint64 version) :
+    m_rows(rows),
+    m_columns(columns),
+    m_columnar(columnar),
+    m_version(version)
+{
+
+}
+
+QVariant QVariantListSnapshot::get(int index) const
+{
+    if(index < 0 || index >= m_rows.count())
+        return QVariant();
+    return fromRow(m_rows.at(index));
+}
+
+QVariant QVariantListSnapshot::value(int index, const QString& field) const
+{
+    if(index < 0 || index >= m_rows.count() || !m_columnar)
+        return QVariant();
+    return m_rows.at(index).value(m_columns.indexOf(field));
+}
+
+QVariantList QVariantListSnapshot::storage() const
+{
+    QVariantList ret;
+    ret.reserve(m_rows.count());
+    for(int i = 0; i < m_rows.count(); ++i)
+        ret.append(fromRow(m_rows.at(i)));
+    return ret;
+}
+
+QVariant QVariantListSnapshot::fromRow(const QVariantListRows::Row& row) const
+{
+    if(!m_columnar)
+        return row.value(0);
+
+    QVariantMap map;
+    for(int column=0; column<row.count(); ++column)
+    {
+        const QVariant& value = row.at(column);
+        if(value.isValid())
+            map.insert(m_columns.at(column), value);
+    }
+    return map;
+}
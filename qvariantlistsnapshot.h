@@ -0,0 +1,43 @@
+#ifndef QVARIANTLISTSNAPSHOT_H
+#define QVARIANTLISTSNAPSHOT_H
+
+#include <QMetaType>
+#include <QStringList>
+#include <QVariant>
+
+#include "qvariantlistrows.h"
+
+// Immutable view of the content of a QVariantListModel at a given version.
+// It shares the row chunks with the model, can be copied freely and read from any thread
+// while the model keeps changing on its own thread.
+class QVariantListSnapshot
+{
+public:
+    QVariantListSnapshot() = default;
+
+    quint64 version() const { return m_version; }
+    int count() const { return m_rows.count(); }
+    bool isEmpty() const { return m_rows.isEmpty(); }
+    const QStringList& fields() const { return m_columns; }
+    bool isColumnar() const { return m_columnar; }
+    const QVariantListRows& rows() const { return m_rows; }
+
+    QVariant get(int index) const;
+    QVariant value(int index, const QString& field) const;
+    QVariantList storage() const;
+
+private:
+    friend class QVariantListModel;
+    QVariantListSnapshot(const QVariantListRows& rows, const QStringList& columns, bool columnar, quint64 version);
+
+    QVariant fromRow(const QVariantListRows::Row& row) const;
+
+    QVariantListRows m_rows;
+    QStringList m_columns;
+    bool m_columnar=false;
+    quint64 m_version=0;
+};
+
+Q_DECLARE_METATYPE (QVariantListSnapshot)
+
+#endif // QVARIANTLISTSNAPSHOT_H
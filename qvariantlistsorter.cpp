@@ -0,0 +1,219 @@
+#include "qvariantlistsorter.h"
+
+#include <QDateTime>
+#include <QThread>
+
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+void QVariantListSorter::addKey(int column, Qt::SortOrder order)
+{
+    m_keys.append({column, order});
+}
+
+QVector<int> QVariantListSorter::sort(const Rows& rows) const
+{
+    QVector<int> order(rows.count());
+    std::iota(order.begin(), order.end(), 0);
+
+    if(m_keys.isEmpty() || rows.count() < 2)
+        return order;
+
+    QVector<SortKey> keys;
+    keys.reserve(m_keys.count());
+    for(const QPair<int, Qt::SortOrder>& key: m_keys)
+        keys.append(extractKey(rows, key.first, key.second));
+
+    // Ties keep their current order
+    const auto lessThan = [&keys](int a, int b) {
+        for(const SortKey& key: keys)
+        {
+            const int cmp = key.compare(a, b);
+            if(cmp != 0)
+                return key.order == Qt::AscendingOrder ? cmp < 0 : cmp > 0;
+        }
+        return a < b;
+    };
+
+    int* data = order.data();
+    const int chunks = qMin(QThread::idealThreadCount(), rows.count() / (ParallelThreshold / 2));
+    if(rows.count() < ParallelThreshold || chunks < 2)
+    {
+        std::sort(data, data + order.count(), lessThan);
+        return order;
+    }
+
+    // Sort one chunk per thread, then merge the chunks two by two
+    QVector<int> bounds;
+    for(int i = 0; i <= chunks; ++i)
+        bounds.append(int(qint64(order.count()) * i / chunks));
+
+    std::vector<std::future<void>> tasks;
+    for(int i = 0; i < chunks; ++i)
+    {
+        tasks.push_back(std::async(std::launch::async, [data, &bounds, &lessThan, i]() {
+            std::sort(data + bounds.at(i), data + bounds.at(i + 1), lessThan);
+        }));
+    }
+    for(std::future<void>& task: tasks)
+        task.wait();
+
+    for(int width = 1; width < chunks; width *= 2)
+    {
+        tasks.clear();
+        for(int i = 0; i + width < chunks; i += 2 * width)
+        {
+            const int first = bounds.at(i);
+            const int middle = bounds.at(i + width);
+            const int last = bounds.at(qMin(i + 2 * width, chunks));
+            tasks.push_back(std::async(std::launch::async, [data, first, middle, last, &lessThan]() {
+                std::inplace_merge(data + first, data + middle, data + last, lessThan);
+            }));
+        }
+        for(std::future<void>& task: tasks)
+            task.wait();
+    }
+
+    return order;
+}
+
+QVariantListSorter::SortKey QVariantListSorter::extractKey(const Rows& rows, int column, Qt::SortOrder order)
+{
+    SortKey key;
+    key.order = order;
+
+    // Use the narrowest representation that fits every value of the column
+    bool numbers = true;
+    bool strings = true;
+    bool floats = false;
+    bool dateTimes = false;
+    bool negatives = false;
+    bool largeUnsigned = false;
+    for(int row = 0; row < rows.count(); ++row)
+    {
+        const QVariant& value = rows.at(row).value(column);
+        if(!value.isValid())
+            continue;
+
+        switch(value.userType())
+        {
+        case QMetaType::Bool:
+        case QMetaType::UInt:
+        case QMetaType::QDate:
+            strings = false;
+            break;
+        case QMetaType::Int:
+        case QMetaType::LongLong:
+            negatives = negatives || value.toLongLong() < 0;
+            strings = false;
+            break;
+        case QMetaType::ULongLong:
+            largeUnsigned = largeUnsigned || value.toULongLong() > quint64(std::numeric_limits<qint64>::max());
+            strings = false;
+            break;
+        case QMetaType::Double:
+        case QMetaType::Float:
+            floats = true;
+            strings = false;
+            break;
+        case QMetaType::QDateTime:
+            dateTimes = true;
+            strings = false;
+            break;
+        case QMetaType::QString:
+            numbers = false;
+            break;
+        default:
+            numbers = false;
+            strings = false;
+            break;
+        }
+
+        if(!numbers && !strings)
+            break;
+    }
+
+    // 64 bit integers don't fit in a double, they are compared as integers unless the column holds floats
+    // or mixes negative values with unsigned values above the signed range
+    if(numbers && !floats && !(negatives && largeUnsigned))
+    {
+        key.type = IntegerKey;
+        key.integers.reserve(rows.count());
+        key.empty.reserve(rows.count());
+        for(int row = 0; row < rows.count(); ++row)
+        {
+            const QVariant& value = rows.at(row).value(column);
+            qint64 integer = 0;
+            if(value.userType() == QMetaType::QDate)
+                integer = dateTimes ? value.toDate().startOfDay().toMSecsSinceEpoch() : value.toDate().toJulianDay();
+            else if(value.userType() == QMetaType::QDateTime)
+                integer = value.toDateTime().toMSecsSinceEpoch();
+            else if(largeUnsigned)
+                // Shifted so that the unsigned order survives the signed comparison
+                integer = qint64(value.toULongLong() ^ (quint64(1) << 63));
+            else
+                integer = value.toLongLong();
+
+            key.integers.append(integer);
+            key.empty.append(!value.isValid());
+        }
+    }
+    else if(numbers)
+    {
+        key.type = NumberKey;
+        key.numbers.reserve(rows.count());
+        for(int row = 0; row < rows.count(); ++row)
+        {
+            const QVariant& value = rows.at(row).value(column);
+            if(!value.isValid())
+                key.numbers.append(-std::numeric_limits<double>::infinity());
+            // Days are enough for dates alone, next to date times they are compared at their start
+            else if(value.userType() == QMetaType::QDate && !dateTimes)
+                key.numbers.append(double(value.toDate().toJulianDay()));
+            else if(value.userType() == QMetaType::QDate)
+                key.numbers.append(double(value.toDate().startOfDay().toMSecsSinceEpoch()));
+            else if(value.userType() == QMetaType::QDateTime)
+                key.numbers.append(double(value.toDateTime().toMSecsSinceEpoch()));
+            else
+                key.numbers.append(value.toDouble());
+        }
+    }
+    else if(strings)
+    {
+        key.type = StringKey;
+        key.strings.reserve(rows.count());
+        for(int row = 0; row < rows.count(); ++row)
+            key.strings.append(rows.at(row).value(column).toString());
+    }
+    else
+    {
+        key.type = VariantKey;
+        key.variants.reserve(rows.count());
+        for(int row = 0; row < rows.count(); ++row)
+            key.variants.append(rows.at(row).value(column));
+    }
+
+    return key;
+}
+
+int QVariantListSorter::SortKey::compare(int a, int b) const
+{
+    switch(type)
+    {
+    case IntegerKey:
+        // Empty cells sort first
+        if(empty.at(a) || empty.at(b))
+            return int(empty.at(b)) - int(empty.at(a));
+        return integers.at(a) < integers.at(b) ? -1 : (integers.at(b) < integers.at(a) ? 1 : 0);
+    case NumberKey:
+        return numbers.at(a) < numbers.at(b) ? -1 : (numbers.at(b) < numbers.at(a) ? 1 : 0);
+    case StringKey:
+        return strings.at(a).compare(strings.at(b));
+    case VariantKey:
+        return variants.at(a) < variants.at(b) ? -1 : (variants.at(b) < variants.at(a) ? 1 : 0);
+    }
+    return 0;
+}
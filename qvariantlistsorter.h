@@ -0,0 +1,51 @@
+#ifndef QVARIANTLISTSORTER_H
+#define QVARIANTLISTSORTER_H
+
+#include <QPair>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+#include "qvariantlistrows.h"
+
+// Sorts the rows of a QVariantListModel on one or more columns.
+// The keys are extracted once into typed arrays, then the row order is sorted in parallel for large lists.
+class QVariantListSorter
+{
+public:
+    using Rows = QVariantListRows;
+
+    void addKey(int column, Qt::SortOrder order = Qt::AscendingOrder);
+    bool isEmpty() const { return m_keys.isEmpty(); }
+
+    // Returns, for each position after sorting, the row it holds before sorting
+    QVector<int> sort(const Rows& rows) const;
+
+    static const int ParallelThreshold = 50000;
+
+private:
+    enum KeyType {
+        IntegerKey,
+        NumberKey,
+        StringKey,
+        VariantKey
+    };
+
+    struct SortKey {
+        KeyType type = NumberKey;
+        Qt::SortOrder order = Qt::AscendingOrder;
+        QVector<qint64> integers;
+        QVector<bool> empty;
+        QVector<double> numbers;
+        QVector<QString> strings;
+        QVector<QVariant> variants;
+
+        int compare(int a, int b) const;
+    };
+
+    static SortKey extractKey(const Rows& rows, int column, Qt::SortOrder order);
+
+    QVector<QPair<int, Qt::SortOrder>> m_keys;
+};
+
+#endif // QVARIANTLISTSORTER_H